@@ -0,0 +1,324 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "timed_automaton.hh"
+
+/*!
+  @brief The binary image of a timed automaton compiled from a .dot file
+
+  The image is the header followed by the flat arrays below, each in the native byte order, so that it is loaded by a memory map without parsing.
+  - the states (StateRecord) in the order of the vertices
+  - the edges (EdgeRecord) in the order of the out-edges of the states
+  - the constraints (ConstraintRecord) of the labels of the states followed by the ones of the guards of the edges
+  - the reset clock variables (uint32) of the edges
+  - the value of the graph attribute "derive"
+ */
+namespace AutomatonCache {
+  constexpr const char magic[8] = {'Q', 'T', 'P', 'M', 'T', 'A', '\0', '\0'};
+  //! @brief Incremented whenever the layout of the image changes
+  constexpr std::uint32_t version = 1;
+  constexpr std::uint32_t byteOrderMark = 0x01020304;
+  //! @brief The suffix of the image next to the .dot file
+  constexpr const char suffix[] = ".qtpmc";
+
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrderMark;
+    std::uint32_t sizeOfSignalVariables;
+    std::uint32_t sizeOfClockVariables;
+    std::uint64_t numOfStates;
+    std::uint64_t numOfEdges;
+    std::uint64_t numOfConstraints;
+    std::uint64_t numOfResets;
+    std::uint64_t deriveSize;
+    std::uint64_t numOfVars;
+    std::uint64_t maxConstraints;
+  };
+
+  struct StateRecord {
+    //! @brief bit 0: initial, bit 1: accepting
+    std::uint32_t flags;
+    std::uint32_t labelSize;
+  };
+
+  struct EdgeRecord {
+    std::uint32_t source;
+    std::uint32_t target;
+    std::uint32_t guardSize;
+    std::uint32_t resetSize;
+  };
+
+  struct ConstraintRecord {
+    std::uint32_t x;
+    //! @brief Constraint::Order, whose largest value is maxOrder
+    std::uint32_t odr;
+    std::int32_t c;
+  };
+  constexpr std::uint32_t maxOrder = std::uint32_t(Constraint<std::uint8_t>::Order::gt);
+
+  static inline std::uint64_t imageSize(const Header &header) {
+    return sizeof(Header) + header.numOfStates * sizeof(StateRecord) + header.numOfEdges * sizeof(EdgeRecord) +
+      header.numOfConstraints * sizeof(ConstraintRecord) + header.numOfResets * sizeof(std::uint32_t) + header.deriveSize;
+  }
+}
+
+//! @brief The file name of the binary image of the automaton in fileName
+static inline std::string automatonCacheFileName(const std::string &fileName) {
+  return fileName + AutomatonCache::suffix;
+}
+
+//! @brief Check if the file begins with the magic of the binary image of an automaton
+static inline bool isAutomatonCache(const std::string &fileName) {
+  FILE *file = fopen(fileName.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  char head[sizeof(AutomatonCache::magic)];
+  const bool result = fread(head, 1, sizeof(head), file) == sizeof(head) && memcmp(head, AutomatonCache::magic, sizeof(head)) == 0;
+  fclose(file);
+  return result;
+}
+
+//! @brief Check if the cache exists and is modified after the source
+static inline bool isAutomatonCacheFresh(const std::string &cacheFileName, const std::string &sourceFileName) {
+  struct stat cache, source;
+  if (stat(cacheFileName.c_str(), &cache) != 0 || stat(sourceFileName.c_str(), &source) != 0) {
+    return false;
+  }
+  return cache.st_mtim.tv_sec > source.st_mtim.tv_sec ||
+    (cache.st_mtim.tv_sec == source.st_mtim.tv_sec && cache.st_mtim.tv_nsec > source.st_mtim.tv_nsec);
+}
+
+/*!
+  @brief Write the binary image of the automaton
+
+  The image is written to a temporary file and renamed, so that another process never loads a partial image.
+
+  @throws std::runtime_error If the image cannot be written
+ */
+template<class SignalVariables, class ClockVariables>
+static inline void writeAutomatonCache(const std::string &fileName, const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA) {
+  using namespace AutomatonCache;
+  using Automaton = BoostTimedAutomaton<SignalVariables, ClockVariables>;
+  std::vector<StateRecord> states;
+  std::vector<EdgeRecord> edges;
+  std::vector<ConstraintRecord> labels;
+  std::vector<ConstraintRecord> guards;
+  std::vector<std::uint32_t> resets;
+  for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+    const auto &state = TA[*range.first];
+    states.push_back({std::uint32_t(state.isInit) | std::uint32_t(state.isMatch) << 1, std::uint32_t(state.label.size())});
+    for (const auto &constraint: state.label) {
+      labels.push_back({std::uint32_t(constraint.x), std::uint32_t(constraint.odr), constraint.c});
+    }
+  }
+  for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+    for (auto edgeRange = boost::out_edges(*range.first, TA); edgeRange.first != edgeRange.second; edgeRange.first++) {
+      const auto &transition = TA[*edgeRange.first];
+      edges.push_back({std::uint32_t(boost::source(*edgeRange.first, TA)), std::uint32_t(boost::target(*edgeRange.first, TA)),
+                       std::uint32_t(transition.guard.size()), std::uint32_t(transition.resetVars.resetVars.size())});
+      for (const auto &constraint: transition.guard) {
+        guards.push_back({std::uint32_t(constraint.x), std::uint32_t(constraint.odr), constraint.c});
+      }
+      resets.insert(resets.end(), transition.resetVars.resetVars.begin(), transition.resetVars.resetVars.end());
+    }
+  }
+  labels.insert(labels.end(), guards.begin(), guards.end());
+  const std::string &derive = boost::get_property(TA, boost::graph_derive);
+
+  Header header;
+  memcpy(header.magic, AutomatonCache::magic, sizeof(header.magic));
+  header.version = AutomatonCache::version;
+  header.byteOrderMark = byteOrderMark;
+  header.sizeOfSignalVariables = sizeof(SignalVariables);
+  header.sizeOfClockVariables = sizeof(ClockVariables);
+  header.numOfStates = states.size();
+  header.numOfEdges = edges.size();
+  header.numOfConstraints = labels.size();
+  header.numOfResets = resets.size();
+  header.deriveSize = derive.size();
+  header.numOfVars = boost::get_property(TA, boost::graph_num_of_vars);
+  header.maxConstraints = boost::get_property(TA, boost::graph_max_constraints);
+  static_assert(std::is_same<typename Automaton::vertex_descriptor, std::size_t>::value, "the states must be indexed");
+
+  const std::string temporaryFileName = fileName + ".tmp" + std::to_string(getpid());
+  FILE *file = fopen(temporaryFileName.c_str(), "wb");
+  if (file == nullptr) {
+    throw std::runtime_error(fileName + ": " + strerror(errno));
+  }
+  bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1;
+  isWritten = isWritten && fwrite(states.data(), sizeof(StateRecord), states.size(), file) == states.size();
+  isWritten = isWritten && fwrite(edges.data(), sizeof(EdgeRecord), edges.size(), file) == edges.size();
+  isWritten = isWritten && fwrite(labels.data(), sizeof(ConstraintRecord), labels.size(), file) == labels.size();
+  isWritten = isWritten && fwrite(resets.data(), sizeof(std::uint32_t), resets.size(), file) == resets.size();
+  isWritten = isWritten && fwrite(derive.data(), 1, derive.size(), file) == derive.size();
+  isWritten = fclose(file) == 0 && isWritten;
+  if (!isWritten || rename(temporaryFileName.c_str(), fileName.c_str()) != 0) {
+    const std::string message = fileName + ": " + strerror(errno);
+    unlink(temporaryFileName.c_str());
+    throw std::runtime_error(message);
+  }
+}
+
+/*!
+  @brief Load the binary image of an automaton by a memory map
+
+  @returns false if the file is not a valid image of this version, e.g., it is written by another version of qtpm or a constraint or a reset refers to a clock variable out of the header. Then TA and initStates are not modified.
+ */
+template<class SignalVariables, class ClockVariables>
+static inline bool loadAutomatonCache(const std::string &fileName, BoostTimedAutomaton<SignalVariables, ClockVariables> &TA,
+                                      std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> &initStates) {
+  using namespace AutomatonCache;
+  using Automaton = BoostTimedAutomaton<SignalVariables, ClockVariables>;
+  const int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || std::uint64_t(st.st_size) < sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+  const std::size_t size = st.st_size;
+  void *image = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) {
+    return false;
+  }
+  struct Unmap {
+    void *image;
+    std::size_t size;
+    ~Unmap() {
+      munmap(image, size);
+    }
+  } unmap = {image, size};
+
+  // The image is page-aligned and each record is 4-byte aligned
+  const char *data = static_cast<const char *>(image);
+  const Header &header = *reinterpret_cast<const Header *>(data);
+  if (memcmp(header.magic, AutomatonCache::magic, sizeof(header.magic)) != 0 || header.version != AutomatonCache::version ||
+      header.byteOrderMark != byteOrderMark || header.sizeOfSignalVariables != sizeof(SignalVariables) ||
+      header.sizeOfClockVariables != sizeof(ClockVariables) || header.numOfStates > size || header.numOfEdges > size ||
+      header.numOfConstraints > size || header.numOfResets > size || header.deriveSize > size || imageSize(header) != size) {
+    return false;
+  }
+  const auto *states = reinterpret_cast<const StateRecord *>(data + sizeof(Header));
+  const auto *edges = reinterpret_cast<const EdgeRecord *>(states + header.numOfStates);
+  const auto *constraints = reinterpret_cast<const ConstraintRecord *>(edges + header.numOfEdges);
+  const auto *resets = reinterpret_cast<const std::uint32_t *>(constraints + header.numOfConstraints);
+  const char *derive = reinterpret_cast<const char *>(resets + header.numOfResets);
+
+  // Validate the counts before building the graph
+  std::uint64_t numOfConstraints = 0;
+  std::uint64_t numOfResets = 0;
+  for (std::size_t i = 0; i < header.numOfStates; i++) {
+    numOfConstraints += states[i].labelSize;
+  }
+  for (std::size_t i = 0; i < header.numOfEdges; i++) {
+    if (edges[i].source >= header.numOfStates || edges[i].target >= header.numOfStates) {
+      return false;
+    }
+    numOfConstraints += edges[i].guardSize;
+    numOfResets += edges[i].resetSize;
+  }
+  if (numOfConstraints != header.numOfConstraints || numOfResets != header.numOfResets ||
+      header.numOfVars > std::uint64_t(std::numeric_limits<ClockVariables>::max()) + 1) {
+    return false;
+  }
+  // The .dot parser never makes a constraint or a reset out of the variables, which would be accessed out of bounds in matching
+  const std::uint64_t numOfLabelConstraints = numOfConstraints - std::accumulate(edges, edges + header.numOfEdges, std::uint64_t(0), [](std::uint64_t sum, const EdgeRecord &edge) {
+      return sum + edge.guardSize;
+    });
+  for (std::size_t i = 0; i < header.numOfConstraints; i++) {
+    const std::uint64_t numOfVars = i < numOfLabelConstraints ? std::uint64_t(std::numeric_limits<SignalVariables>::max()) + 1 : header.numOfVars;
+    if (constraints[i].x >= numOfVars || constraints[i].odr > maxOrder) {
+      return false;
+    }
+  }
+  for (std::size_t i = 0; i < header.numOfResets; i++) {
+    if (resets[i] >= header.numOfVars) {
+      return false;
+    }
+  }
+  const auto toConstraint = [](const ConstraintRecord &record, auto &constraint) {
+    using C = typename std::decay<decltype(constraint)>::type;
+    constraint.x = record.x;
+    constraint.odr = static_cast<typename C::Order>(record.odr);
+    constraint.c = record.c;
+  };
+
+  Automaton result(header.numOfStates);
+  std::vector<typename Automaton::vertex_descriptor> resultInitStates;
+  for (std::size_t i = 0; i < header.numOfStates; i++) {
+    auto &state = result[i];
+    state.isInit = states[i].flags & 1;
+    state.isMatch = states[i].flags & 2;
+    state.label.resize(states[i].labelSize);
+    for (auto &constraint: state.label) {
+      toConstraint(*constraints++, constraint);
+    }
+    if (state.isInit) {
+      resultInitStates.push_back(i);
+    }
+  }
+  for (std::size_t i = 0; i < header.numOfEdges; i++) {
+    BoostTATransition<ClockVariables> transition;
+    transition.guard.resize(edges[i].guardSize);
+    for (auto &constraint: transition.guard) {
+      toConstraint(*constraints++, constraint);
+    }
+    transition.resetVars.resetVars.assign(resets, resets + edges[i].resetSize);
+    resets += edges[i].resetSize;
+    boost::add_edge(edges[i].source, edges[i].target, std::move(transition), result);
+  }
+  boost::set_property(result, boost::graph_num_of_vars, std::size_t(header.numOfVars));
+  boost::set_property(result, boost::graph_max_constraints, std::size_t(header.maxConstraints));
+  boost::set_property(result, boost::graph_derive, std::string(derive, header.deriveSize));
+
+  TA = std::move(result);
+  initStates = std::move(resultInitStates);
+  return true;
+}
+
+/*!
+  @brief Load a timed automaton from a .dot file or its binary image
+
+  If fileName is a binary image, it is loaded. Otherwise, if useCache holds and the image next to fileName (see automatonCacheFileName) is newer than fileName, the image is loaded instead of parsing fileName.
+
+  @throws std::runtime_error If the file cannot be read or a given binary image is invalid
+ */
+template<class SignalVariables, class ClockVariables>
+static inline void loadBoostTA(const std::string &fileName, BoostTimedAutomaton<SignalVariables, ClockVariables> &TA,
+                               std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> &initStates,
+                               bool useCache = true) {
+  if (isAutomatonCache(fileName)) {
+    if (!loadAutomatonCache(fileName, TA, initStates)) {
+      throw std::runtime_error(fileName + ": invalid or incompatible binary image of an automaton");
+    }
+    return;
+  }
+  const std::string cacheFileName = automatonCacheFileName(fileName);
+  if (useCache && isAutomatonCacheFresh(cacheFileName, fileName) && loadAutomatonCache(cacheFileName, TA, initStates)) {
+    return;
+  }
+  std::ifstream taStream(fileName);
+  if (!taStream) {
+    throw std::runtime_error(fileName + ": " + strerror(errno));
+  }
+  parseBoostTA(taStream, TA, initStates);
+}
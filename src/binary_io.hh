@@ -0,0 +1,88 @@
+#pragma once
+
+#include <iostream>
+#include <limits>
+#include <type_traits>
+
+#include "dbm.hh"
+
+/*!
+  @brief Write a trivially copyable value in the native byte order
+
+  @note All the binary formats in this tool use the native byte order, i.e., little-endian on the supported platforms.
+ */
+template<class T>
+static inline void writeBinary(std::ostream &os, const T &x) {
+  static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be written");
+  os.write(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+
+/*!
+  @brief The number of the bytes left in the input
+
+  This bounds the sizes read from a broken input before allocating the memory for them. If the input is not seekable, e.g., a pipe, the maximum of std::size_t is returned.
+ */
+static inline std::size_t remainingBytes(std::istream &is) {
+  const auto current = is.tellg();
+  if (current == std::istream::pos_type(-1)) {
+    return std::numeric_limits<std::size_t>::max();
+  }
+  is.seekg(0, std::ios::end);
+  const auto end = is.tellg();
+  is.seekg(current);
+  if (end == std::istream::pos_type(-1) || !is) {
+    is.clear();
+    is.seekg(current);
+    return std::numeric_limits<std::size_t>::max();
+  }
+  return std::size_t(end - current);
+}
+
+//! @brief Read a trivially copyable value written by writeBinary
+template<class T>
+static inline bool readBinary(std::istream &is, T &x) {
+  static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be read");
+  return bool(is.read(reinterpret_cast<char*>(&x), sizeof(T)));
+}
+
+static inline void writeBinary(std::ostream &os, const Bounds &b) {
+  writeBinary(os, b.first);
+  writeBinary(os, uint8_t(b.second));
+}
+
+static inline bool readBinary(std::istream &is, Bounds &b) {
+  uint8_t isClosed;
+  if (!readBinary(is, b.first) || !readBinary(is, isClosed)) {
+    return false;
+  }
+  b.second = isClosed;
+  return true;
+}
+
+//! @brief Write a DBM as its dimension, its elements in the column-major order, and the threshold M
+static inline void writeBinary(std::ostream &os, const DBM &z) {
+  writeBinary(os, uint32_t(z.value.cols()));
+  for (auto it = z.value.data(); it < z.value.data() + z.value.size(); it++) {
+    writeBinary(os, *it);
+  }
+  writeBinary(os, z.M);
+}
+
+/*!
+  @brief Read a DBM of the given dimension written by writeBinary
+
+  @retval false if the input is broken or the dimension is different. The memory is allocated only after checking the dimension.
+ */
+static inline bool readBinary(std::istream &is, DBM &z, uint32_t dimension) {
+  uint32_t size;
+  if (!readBinary(is, size) || size != dimension) {
+    return false;
+  }
+  z.value.resize(size, size);
+  for (auto it = z.value.data(); it < z.value.data() + z.value.size(); it++) {
+    if (!readBinary(is, *it)) {
+      return false;
+    }
+  }
+  return readBinary(is, z.M);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <future>
+#include <boost/unordered_map.hpp>
+
+#include "quantitative_timed_pattern_matching.hh"
+#include "thread_pool.hh"
+
+/*!
+  @brief Quantitative timed pattern matching of an entire signal split into chunks processed in parallel
+
+  Each chunk is processed by a copy of the given matcher. The matcher of a chunk starts the matching only in its own pieces and extends them to the pieces after the chunk until their duration exceeds maxDuration. Thus, the matching starting in the chunk is found exactly in the same way as the sequential matching, and the chunks overlap only by maxDuration.
+
+  The result is given to the sink in the order of the chunks. The matching at a boundary of two chunks, e.g., the one starting exactly at the boundary, may be found by both chunks; such a duplicated matching is merged before it is given to the sink. A matching is flagged as possibly over-approximated if the matcher of any chunk finding it flags it.
+
+  @param [in] prototype The matcher copied for each chunk. Its options, e.g., the threshold, are inherited.
+  @param [in] maxDuration An upper bound of the duration of any matching (see @ref maxMatchDuration)
+  @param [in] numOfChunks The number of the chunks. Each chunk is made at least as long as maxDuration so that the overlap does not dominate.
+  @returns The total numbers of the over-approximations and the configurations removed by them in all the chunks
+  @pre No piece is fed to prototype yet.
+ */
+template<class SignalVariables, class ClockVariables, class Weight, class Value>
+std::pair<std::size_t, std::size_t> chunkedMatching(const QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> &prototype,
+                     const std::vector<std::vector<Value>> &valuations,
+                     const std::vector<double> &durations,
+                     const double maxDuration,
+                     ThreadPool &pool,
+                     const std::size_t numOfChunks,
+                     const typename QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value>::ResultSink &sink) {
+  using Matcher = QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value>;
+  using ResultMatrix = typename Matcher::ResultMatrix;
+  using Result = boost::unordered_map<ResultMatrix, std::pair<Weight, bool>>;
+
+  const std::size_t size = valuations.size();
+  // beginTimes[i] is the absolute time at the beginning of the i-th piece
+  std::vector<double> beginTimes(size + 1);
+  beginTimes[0] = prototype.getAbsTime();
+  for (std::size_t i = 0; i < size; i++) {
+    beginTimes[i + 1] = beginTimes[i] + durations[i];
+  }
+
+  // Split the pieces into chunks [boundaries[i], boundaries[i + 1])
+  std::vector<std::size_t> boundaries = {0};
+  const std::size_t chunkSize = std::max<std::size_t>(1, (size + numOfChunks - 1) / std::max<std::size_t>(1, numOfChunks));
+  while (boundaries.back() < size) {
+    const std::size_t begin = boundaries.back();
+    std::size_t end = std::min(size, begin + chunkSize);
+    while (end < size && beginTimes[end] - beginTimes[begin] < maxDuration) {
+      end++;
+    }
+    boundaries.push_back(end);
+  }
+
+  std::vector<Result> results(boundaries.size() - 1);
+  std::vector<std::pair<std::size_t, std::size_t>> approximations(results.size());
+  std::vector<std::future<void>> futures;
+  futures.reserve(results.size());
+  for (std::size_t chunk = 0; chunk + 1 < boundaries.size(); chunk++) {
+    futures.push_back(pool.submit([&, chunk] {
+          const std::size_t begin = boundaries[chunk];
+          const std::size_t end = boundaries[chunk + 1];
+          Matcher matcher = prototype;
+          matcher.setResultSink(nullptr);
+          matcher.startAt(beginTimes[begin]);
+          for (std::size_t i = begin; i < end; i++) {
+            matcher.feed(valuations[i], durations[i]);
+          }
+          // Extend the matching starting in this chunk
+          matcher.setStartMatching(false);
+          for (std::size_t i = end; i < size && beginTimes[i] < beginTimes[end] + maxDuration &&
+                 matcher.getNumOfConfigurations() > 0; i++) {
+            matcher.feed(valuations[i], durations[i]);
+          }
+          for (const auto &r: matcher.getResultRef()) {
+            results[chunk].emplace(r.first, std::make_pair(r.second, matcher.isApproximate(r.first)));
+          }
+          approximations[chunk] = std::make_pair(matcher.getNumOfApproximations(), matcher.getNumOfMergedConfigurations());
+        }));
+  }
+
+  // Whether the range of the beginning of the matching contains the given time
+  const auto containsBeginning = [](const ResultMatrix &mat, double time) {
+    return -mat[0].first <= time && time <= mat[1].first;
+  };
+
+  // The matching at the end of the previous chunk, which may also be found by the current chunk
+  Result boundaryResult;
+  for (std::size_t chunk = 0; chunk < futures.size(); chunk++) {
+    futures[chunk].get();
+    const double beginTime = beginTimes[boundaries[chunk]];
+    const double endTime = beginTimes[boundaries[chunk + 1]];
+    const bool isLast = chunk + 1 == futures.size();
+    for (auto it = results[chunk].begin(); it != results[chunk].end();) {
+      if (chunk > 0 && containsBeginning(it->first, beginTime)) {
+        auto jt = boundaryResult.find(it->first);
+        if (jt == boundaryResult.end()) {
+          boundaryResult.insert(*it);
+        } else {
+          jt->second.first += it->second.first;
+          jt->second.second = jt->second.second || it->second.second;
+        }
+        it = results[chunk].erase(it);
+      } else {
+        it++;
+      }
+    }
+    for (const auto &r: boundaryResult) {
+      sink(r.first, r.second.first, r.second.second);
+    }
+    boundaryResult.clear();
+    for (const auto &r: results[chunk]) {
+      if (!isLast && containsBeginning(r.first, endTime)) {
+        boundaryResult.insert(r);
+      } else {
+        sink(r.first, r.second.first, r.second.second);
+      }
+    }
+    results[chunk].clear();
+  }
+
+  std::pair<std::size_t, std::size_t> total = {0, 0};
+  for (const auto &approximation: approximations) {
+    total.first += approximation.first;
+    total.second += approximation.second;
+  }
+  return total;
+}
@@ -135,15 +135,19 @@ struct DBM {
     // }
   }
   
-  //! @note the result is not canonized
+  /*!
+   * @brief remove the constraints on x except \f$x \ge 0\f$
+   *
+   * Since \f$y - x \le y\f$ for any \f$y\f$, the bound of \f$y - x\f$ is the upper bound of \f$y\f$. Therefore, the result is canonical if the zone is canonical.
+   */
   void release(uint8_t x) {
     static constexpr Bounds infinity = Bounds(std::numeric_limits<double>::infinity(), false);
     // 0 is the special varibale here
     x++;
-    value.col(x).fill(infinity);
     value.row(x).fill(infinity);
+    value.col(x) = value.col(0);
     value(0,x) = Bounds(0, true);
-    value(x,0) = infinity;
+    value(x,x) = Bounds(0, true);
   }
 
   /*!
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/optional.hpp>
+
+#include "signal_reader.hh"
+
+/*!
+  @brief A signal variable derived from another one over a sliding time window
+
+  The derived value of a piece is evaluated at the end t of the piece over the window (t - window, t].
+ */
+struct Derivation {
+  enum class Kind {
+    //! @brief v(t) - v(t - window), where v(t - window) is the value of the piece containing t - window (or the first piece)
+    difference,
+    //! @brief The average of v over the window weighted by the duration
+    mean,
+    //! @brief The minimum of v over the window
+    min,
+    //! @brief The maximum of v over the window
+    max
+  };
+  Kind kind;
+  //! @brief The index of the signal variable the value is derived from
+  std::size_t variable;
+  double window;
+
+  bool operator==(const Derivation &other) const {
+    return kind == other.kind && variable == other.variable && window == other.window;
+  }
+};
+
+/*!
+  @brief Parse a derivation such as "diff(x0,10)", "mean(x1,5)", "min(x0,3)", or "max(x0,3)"
+
+  @returns The derivation. If the string is invalid, boost::none is returned.
+ */
+static inline boost::optional<Derivation> parseDerivation(const std::string &str) {
+  const auto open = str.find('(');
+  const auto comma = str.find(',');
+  if (open == std::string::npos || comma == std::string::npos || comma < open || str.back() != ')') {
+    return boost::none;
+  }
+  Derivation derivation;
+  const std::string name = str.substr(0, open);
+  if (name == "diff") {
+    derivation.kind = Derivation::Kind::difference;
+  } else if (name == "mean") {
+    derivation.kind = Derivation::Kind::mean;
+  } else if (name == "min") {
+    derivation.kind = Derivation::Kind::min;
+  } else if (name == "max") {
+    derivation.kind = Derivation::Kind::max;
+  } else {
+    return boost::none;
+  }
+  const std::string variable = str.substr(open + 1, comma - open - 1);
+  const std::string window = str.substr(comma + 1, str.size() - comma - 2);
+  if (variable.size() < 2 || variable[0] != 'x' ||
+      !std::all_of(variable.begin() + 1, variable.end(), [](char c) { return std::isdigit(c); }) ||
+      !parseDouble(window.data(), window.data() + window.size(), derivation.window) || !(derivation.window >= 0)) {
+    return boost::none;
+  }
+  derivation.variable = std::stoul(variable.substr(1));
+  return derivation;
+}
+
+/*!
+  @brief Parse the derivations separated by spaces or semicolons
+
+  @throws std::runtime_error If a derivation is invalid
+ */
+static inline std::vector<Derivation> parseDerivations(const std::string &str) {
+  std::vector<Derivation> derivations;
+  std::size_t begin = 0;
+  while (begin < str.size()) {
+    const std::size_t end = std::min(str.find_first_of(" \t;", begin), str.size());
+    if (end > begin) {
+      const std::string token = str.substr(begin, end - begin);
+      const auto derivation = parseDerivation(token);
+      if (!derivation) {
+        throw std::runtime_error("invalid derivation: " + token);
+      }
+      derivations.push_back(*derivation);
+    }
+    begin = end + 1;
+  }
+  return derivations;
+}
+
+/*!
+  @brief The value of a derivation updated incrementally piece by piece
+
+  Only the pieces intersecting the window are kept. The minimum and the maximum are maintained by a monotonic deque, and the mean by a running sum, so that each piece is processed in amortized constant time.
+ */
+class SlidingWindow {
+public:
+  SlidingWindow(Derivation::Kind kind, double window) : kind(kind), window(window) {}
+
+  /*!
+    @brief Add the piece [begin, end) of the value and return the derived value at end
+
+    @pre begin <= end and begin is the end of the previous piece
+   */
+  double push(double begin, double end, double value) {
+    const double windowBegin = end - window;
+    switch (kind) {
+    case Derivation::Kind::difference:
+      pieces.push_back({begin, end, value});
+      // Keep the piece containing windowBegin at the front
+      while (pieces.front().end < windowBegin) {
+        pieces.pop_front();
+      }
+      return value - pieces.front().value;
+    case Derivation::Kind::mean: {
+      pieces.push_back({begin, end, value});
+      sum += value * (end - begin);
+      while (pieces.size() > 1 && pieces.front().end <= windowBegin) {
+        sum -= pieces.front().value * (pieces.front().end - pieces.front().begin);
+        pieces.pop_front();
+      }
+      if (pieces.size() == 1) {
+        // Cancel the accumulated rounding error
+        sum = value * (end - begin);
+      }
+      const Piece &front = pieces.front();
+      const double effectiveBegin = std::max(windowBegin, front.begin);
+      if (end <= effectiveBegin) {
+        return value;
+      }
+      return (sum - front.value * (effectiveBegin - front.begin)) / (end - effectiveBegin);
+    }
+    case Derivation::Kind::min:
+    case Derivation::Kind::max: {
+      const bool isMin = kind == Derivation::Kind::min;
+      // The values in the deque are strictly increasing (min) or decreasing (max) from the front
+      while (!pieces.empty() && (isMin ? pieces.back().value >= value : pieces.back().value <= value)) {
+        pieces.pop_back();
+      }
+      pieces.push_back({begin, end, value});
+      while (pieces.front().end <= windowBegin && pieces.size() > 1) {
+        pieces.pop_front();
+      }
+      return pieces.front().value;
+    }
+    }
+    return value;
+  }
+
+private:
+  struct Piece {
+    double begin;
+    double end;
+    double value;
+  };
+  const Derivation::Kind kind;
+  const double window;
+  std::deque<Piece> pieces;
+  //! @brief The sum of the value times the duration of the pieces (mean only)
+  double sum = 0;
+};
+
+/*!
+  @brief Append the derived signal variables to the pieces read by another reader
+
+  The derived variables are appended in the order of the derivations, so a derivation can refer to the variables derived before it.
+ */
+class DerivedSignalReader : public SignalReader {
+public:
+  /*!
+    @param [in] isAbsTime If the time of the signal is the absolute time. The relative time starts from 0.
+   */
+  DerivedSignalReader(std::unique_ptr<SignalReader> reader, const std::vector<Derivation> &derivations, bool isAbsTime) :
+    SignalReader(reader->getFileName()), reader(std::move(reader)), derivations(derivations), isAbsTimeMode(isAbsTime) {
+    windows.reserve(derivations.size());
+    for (const Derivation &derivation: derivations) {
+      windows.emplace_back(derivation.kind, derivation.window);
+    }
+  }
+
+  /*!
+    @copydoc SignalReader::next
+
+    @throws std::runtime_error If a derivation refers to an undefined variable
+   */
+  bool next(double &time, std::vector<double> &valuation) override {
+    if (!reader->next(time, valuation)) {
+      return false;
+    }
+    const double begin = lastTime;
+    lastTime = isAbsTimeMode ? time : lastTime + time;
+    for (std::size_t i = 0; i < derivations.size(); i++) {
+      if (derivations[i].variable >= valuation.size()) {
+        throw std::runtime_error(fileName + ": x" + std::to_string(derivations[i].variable) + " in a derivation is not defined");
+      }
+      valuation.push_back(windows[i].push(begin, lastTime, valuation[derivations[i].variable]));
+    }
+    return true;
+  }
+
+  boost::optional<bool> isAbsTime() const override {
+    return reader->isAbsTime();
+  }
+
+private:
+  const std::unique_ptr<SignalReader> reader;
+  const std::vector<Derivation> derivations;
+  std::vector<SlidingWindow> windows;
+  const bool isAbsTimeMode;
+  //! @brief The end of the last piece
+  double lastTime = 0;
+};
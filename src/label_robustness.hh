@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <map>
+
+#include "timed_automaton.hh"
+
+/*!
+  @brief The space robustness of each label of a timed automaton over a block of pieces
+
+  The labels of a timed automaton are few and fixed. Each distinct label gets an index and is converted to the coefficient arrays of its constraints: the signal variable, the constant, and if it is an upper bound. For a block of pieces given by columns, each constraint is evaluated by a loop over the pieces without branches, which the compiler vectorizes, and the robustness is kept in a label × piece table. Each entry is the same as @ref singleSpaceRobustness.
+ */
+template<class Weight, class Value, class SignalVariables>
+class LabelRobustnessTable {
+public:
+  template<class ClockVariables>
+  explicit LabelRobustnessTable(const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA) {
+    std::map<std::vector<std::tuple<int, int, int>>, std::size_t> toLabel;
+    labelBegin.push_back(0);
+    stateLabels.reserve(boost::num_vertices(TA));
+    for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+      const auto &label = TA[*range.first].label;
+      std::vector<std::tuple<int, int, int>> key;
+      key.reserve(label.size());
+      for (const auto &constraint: label) {
+        key.emplace_back(int(constraint.x), int(constraint.odr), constraint.c);
+      }
+      const auto it = toLabel.emplace(std::move(key), toLabel.size());
+      stateLabels.push_back(it.first->second);
+      if (!it.second) {
+        continue;
+      }
+      for (const auto &constraint: label) {
+        variables.push_back(constraint.x);
+        constants.push_back(constraint.c);
+        isUpperBound.push_back(constraint.odr == Constraint<SignalVariables>::Order::lt ||
+                               constraint.odr == Constraint<SignalVariables>::Order::le);
+      }
+      labelBegin.push_back(variables.size());
+    }
+  }
+
+  //! @brief The number of the distinct labels
+  std::size_t getNumOfLabels() const {
+    return labelBegin.size() - 1;
+  }
+
+  //! @brief The index of the label of the given state of the TA
+  std::size_t labelOf(std::size_t state) const {
+    return stateLabels[state];
+  }
+
+  /*!
+    @brief Evaluate every label over a block of pieces
+
+    @param [in] size The number of the pieces
+    @param [in] columns columns[j][i] is the value of the j-th signal variable in the i-th piece
+   */
+  void evaluate(const std::size_t size, const std::vector<const Value*> &columns) {
+    numOfPieces = size;
+    table.assign(getNumOfLabels() * size, Weight::one());
+    for (std::size_t label = 0; label < getNumOfLabels(); label++) {
+      Weight *row = table.data() + label * size;
+      for (std::size_t k = labelBegin[label]; k < labelBegin[label + 1]; k++) {
+        const Value *column = columns[variables[k]];
+        const Value c = constants[k];
+        if (isUpperBound[k]) {
+          for (std::size_t i = 0; i < size; i++) {
+            row[i] *= Weight(c - column[i]);
+          }
+        } else {
+          for (std::size_t i = 0; i < size; i++) {
+            row[i] *= Weight(column[i] - c);
+          }
+        }
+      }
+    }
+  }
+
+  //! @brief The robustness of the label for the piece of the block evaluated last
+  const Weight &at(std::size_t label, std::size_t piece) const {
+    return table[label * numOfPieces + piece];
+  }
+
+private:
+  //! @brief The index of the label of each state of the TA
+  std::vector<std::size_t> stateLabels;
+  //! @brief The constraints of the i-th label are in [labelBegin[i], labelBegin[i + 1]) of the coefficient arrays
+  std::vector<std::size_t> labelBegin;
+  std::vector<SignalVariables> variables;
+  std::vector<Value> constants;
+  //! @brief If each constraint is \f$x < c\f$ or \f$x \le c\f$, whose robustness is \f$c - x\f$. Otherwise, it is \f$x - c\f$.
+  std::vector<bool> isUpperBound;
+  //! @brief table[label * numOfPieces + piece] is the robustness of the label for the piece
+  std::vector<Weight> table;
+  std::size_t numOfPieces = 0;
+};
@@ -1,119 +1,326 @@
 #include <iostream>
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
 #include <cstdio>
+#include <cstring>
+#include <list>
+#include <map>
 #include <boost/program_options.hpp>
+#include <dirent.h>
 
-#include "quantitative_timed_pattern_matching.hh"
-#include "robustness.hh"
+#include "automaton_cache.hh"
+#include "derived_signal.hh"
+#include "monitor.hh"
+#include "qtpm_driver.hh"
+#include "thread_pool.hh"
+#include "timed_automaton_preprocessing.hh"
+#include "signal_reader.hh"
+#include "unix_socket.hh"
 
 using namespace boost::program_options;
 
-// fgets without file lock/unlock. We have to lock/unlock manually.
-static inline char *fgets_unsafe(char * chr, int n, FILE *stream) {
-  char * init_chr = chr;
-  int c;
-  char * ret = nullptr;
-  if (--n <= 0) {
-    return nullptr;
+/*!
+  @brief Parse a size in bytes with an optional suffix K, M, or G
+
+  @returns The size in bytes. If the string is invalid, boost::none is returned.
+ */
+static inline boost::optional<std::size_t> parseSize(const std::string &str) {
+  std::size_t pos;
+  double size;
+  try {
+    size = std::stod(str, &pos);
+  } catch (const std::exception &) {
+    return boost::none;
+  }
+  const std::string suffix = str.substr(pos);
+  if (suffix == "K" || suffix == "k") {
+    size *= 1024;
+  } else if (suffix == "M" || suffix == "m") {
+    size *= 1024 * 1024;
+  } else if (suffix == "G" || suffix == "g") {
+    size *= 1024 * 1024 * 1024;
+  } else if (!suffix.empty()) {
+    return boost::none;
   }
-  while ((c = getc_unlocked(stream)) != EOF) {
-    ret = init_chr;
-    if (c == '\n') {
-      *chr = '\0';
-      return init_chr;
+  if (size < 0) {
+    return boost::none;
+  }
+  return std::size_t(size);
+}
+
+//! @brief Print what is removed from the automaton by the preprocessing
+static inline void printPreprocessingReport(const std::string &name, const PreprocessingReport &report) {
+  fprintf(stderr, "qtpm: %s: %zu -> %zu states (%zu unreachable, %zu useless, %zu merged), %zu -> %zu transitions (%zu unsatisfiable), %zu -> %zu clock variables\n",
+          name.c_str(), report.numOfStatesBefore, report.numOfStatesAfter, report.numOfUnreachableStates, report.numOfUselessStates,
+          report.numOfMergedStates, report.numOfTransitionsBefore, report.numOfTransitionsAfter, report.numOfUnsatisfiableTransitions,
+          report.numOfClockVariablesBefore, report.numOfClockVariablesAfter);
+}
+
+/*!
+  @brief Feed the signal to the monitors in parallel
+
+  The signal is read by blocks and each monitor consumes the block in its own task. The result of each monitor is buffered and printed in the order of the monitors after each block.
+ */
+static inline void parallelQTPM(std::vector<MonitorPtr> &monitors, SignalReader &fin, FILE* fout, const QTPMOptions &options) {
+  ThreadPool pool(std::min(options.jobs, monitors.size()));
+
+  // The buffer of the result for each monitor
+  std::vector<char*> buffers(monitors.size(), nullptr);
+  std::vector<std::size_t> bufferSizes(monitors.size(), 0);
+  std::vector<FILE*> bufferFiles(monitors.size());
+  for (std::size_t i = 0; i < monitors.size(); i++) {
+    bufferFiles[i] = open_memstream(&buffers[i], &bufferSizes[i]);
+    monitors[i]->setOutput(bufferFiles[i]);
+  }
+  const auto writeBuffers = [&] {
+    for (std::size_t i = 0; i < monitors.size(); i++) {
+      fflush(bufferFiles[i]);
+      fwrite(buffers[i], 1, bufferSizes[i], fout);
+      rewind(bufferFiles[i]);
     }
-    *chr = c;
-    chr++;
-    if (--n <= 0) {
-      *chr = '\0';
-      return init_chr;
+  };
+
+  BlockReader reader(fin, options.isAbsTime, 0.0);
+  PieceBlock block;
+  while (reader.read(options.blockSize, block)) {
+    std::vector<std::future<void>> futures;
+    futures.reserve(monitors.size());
+    for (auto &monitor: monitors) {
+      futures.push_back(pool.submit([&monitor, &block] {
+            monitor->feedBatch(block.size, block.durations.data(), block.columnPointers);
+            monitor->printResult();
+          }));
+    }
+    for (auto &future: futures) {
+      future.get();
     }
+    writeBuffers();
+  }
+  for (auto &monitor: monitors) {
+    monitor->flushResult();
+  }
+  writeBuffers();
+
+  for (std::size_t i = 0; i < monitors.size(); i++) {
+    monitors[i]->setOutput(fout);
+    fclose(bufferFiles[i]);
+    free(buffers[i]);
   }
-  return ret;
 }
 
-template<class Value>
-static inline int getOne(FILE* file, double &time, std::vector<Value> &valuation) {
-  std::array<char, 100> str;
-  if (!fgets_unsafe(str.data(), 100, file)) {
-    return EOF;
+/*!
+  @brief Feed the entire signal to the monitor by chunks in parallel
+
+  The chunks overlap by the maximum duration of the matching inferred from the automaton. Each thread processes more than one chunk for load balancing.
+ */
+static inline void chunkedQTPM(Monitor<SignalVariables, ClockVariables, Value> &monitor, SignalReader &fin, const QTPMOptions &options) {
+  constexpr std::size_t chunksPerThread = 4;
+  std::vector<std::vector<Value>> valuations;
+  std::vector<double> durations;
+  double time;
+  double last_time = 0.0;
+  std::vector<Value> valuation;
+  while (fin.next(time, valuation)) {
+    durations.push_back(options.isAbsTime ? time - last_time : time);
+    last_time = time;
+    valuations.push_back(std::move(valuation));
   }
-  std::stringstream ss(std::string(str.data()));
-  ss >> time;
-  
-  while (!ss.eof()) {
-    Value v;
-    ss >> v;
-    if (ss.fail()) {
-      return valuation.size() + 1;
+
+  ThreadPool pool(options.jobs);
+  monitor.feedInChunks(valuations, durations, pool, options.jobs * chunksPerThread);
+}
+
+/*!
+  @brief List the signal files of the batch mode
+
+  A directory is expanded to the regular files in it in the lexicographic order, skipping the hidden files.
+
+  @throws std::runtime_error If a path cannot be read
+ */
+static inline std::vector<std::string> listBatchFiles(const std::vector<std::string> &paths) {
+  std::vector<std::string> fileNames;
+  for (const std::string &path: paths) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+      throw std::runtime_error(path + ": " + std::strerror(errno));
+    }
+    if (!S_ISDIR(st.st_mode)) {
+      fileNames.push_back(path);
+      continue;
+    }
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) {
+      throw std::runtime_error(path + ": " + std::strerror(errno));
     }
-    valuation.push_back(std::move(v));
+    std::vector<std::string> entries;
+    while (const struct dirent *entry = readdir(dir)) {
+      const std::string fileName = path + (path.back() == '/' ? "" : "/") + entry->d_name;
+      if (entry->d_name[0] != '.' && stat(fileName.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        entries.push_back(fileName);
+      }
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    fileNames.insert(fileNames.end(), entries.begin(), entries.end());
   }
-  return valuation.size() + 1;
+  return fileNames;
 }
 
-template<class RawWeight>
-void printResult(FILE* fout, std::array<Bounds, 6> arr, RawWeight weight) {
-  fprintf(fout, "----- Weight: %lf -----\n", weight);
-  fprintf(fout, "%10lf %8s t %s %10lf\n", -arr[0].first,
-          (arr[0].second ? "<=" : "<"),
-          (arr[1].second ? "<=" : "<"),
-          arr[1].first);
-  fprintf(fout, "%10lf %8s t' %s %10lf\n", -arr[2].first,
-          (arr[2].second ? "<=" : "<"),
-          (arr[3].second ? "<=" : "<"),
-          arr[3].first);
-  fprintf(fout, "%10lf %8s t' - t %s %10lf\n", -arr[4].first,
-          (arr[4].second ? "<=" : "<"),
-          (arr[5].second ? "<=" : "<"),
-          arr[5].first);
-  fputs("=============================\n", fout);
-}
+/*!
+  @brief The name of the result file of a signal file in the batch mode
 
-template<>
-void printResult<bool>(FILE* fout, std::array<Bounds, 6> arr, bool weight) {
-  if (weight) {
-    fprintf(fout, "%10lf %8s t %s %10lf\n", -arr[0].first,
-            (arr[0].second ? "<=" : "<"),
-            (arr[1].second ? "<=" : "<"),
-            arr[1].first);
-    fprintf(fout, "%10lf %8s t' %s %10lf\n", -arr[2].first,
-            (arr[2].second ? "<=" : "<"),
-            (arr[3].second ? "<=" : "<"),
-            arr[3].first);
-    fprintf(fout, "%10lf %8s t' - t %s %10lf\n", -arr[4].first,
-            (arr[4].second ? "<=" : "<"),
-            (arr[5].second ? "<=" : "<"),
-            arr[5].first);
-    fputs("=============================\n", fout);
+  The directories in the path are flattened so that the signal files of the same name in different directories do not collide, e.g., "data/a/signal.tsv" is written to "data_a_signal.tsv.csv" in the CSV format. Since the flattening is not injective, batchQTPM rejects the files of the same result file.
+ */
+static inline std::string batchResultFileName(std::string fileName, ResultFormat format) {
+  while (fileName.compare(0, 2, "./") == 0) {
+    fileName.erase(0, 2);
+  }
+  while (!fileName.empty() && fileName.front() == '/') {
+    fileName.erase(0, 1);
   }
+  std::replace(fileName.begin(), fileName.end(), '/', '_');
+  switch (format) {
+  case ResultFormat::text:
+    return fileName + ".txt";
+  case ResultFormat::csv:
+    return fileName + ".csv";
+  case ResultFormat::jsonl:
+    return fileName + ".jsonl";
+  case ResultFormat::binary:
+    return fileName + ".bin";
+  }
+  return fileName;
 }
 
+//! @brief The summary of a signal file in the batch mode
+struct BatchSummary {
+  std::size_t numOfPieces = 0;
+  //! @brief The elapsed time to read, match, and write the result
+  double seconds = 0;
+  //! @brief The maximum number of the configurations of any monitor
+  std::size_t peakNumOfConfigurations = 0;
+};
 
-template<class SignalVariables, class ClockVariables, class Weight, class Value>
-static inline void QTPM(QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> &qtpm, FILE* fin, FILE* fout, bool quiet, bool isAbsTime) {
-  flockfile(fin);
-  double time;
-  std::vector<Value> valuation;
-  double last_time = 0.0;
-  while(getOne(fin, time, valuation) != EOF) {
-    if (isAbsTime) {
-      qtpm.feed(valuation, time - last_time);
-      last_time = time;
-    } else {
-      qtpm.feed(valuation, time);
+/*!
+  @brief Match each signal file with the automata parsed once, processing the files in parallel
+
+  Each file is read and matched by its own monitors in a worker thread, and its result is written to its own file in outputDirectory. After each file, a summary line of the file name, the number of the pieces, the elapsed seconds, and the peak number of the configurations is printed in the order of the files. A file failing to be matched is reported to stderr without stopping the others.
+
+  @param [in] outputDirectory The directory of the result files. If it is empty, the result is not written, which is used with --quiet.
+  @returns If all the files are matched
+  @throws std::runtime_error If two files have the same result file, e.g., "a/b_c.tsv" and "a_b/c.tsv" or a file given twice
+ */
+static inline bool batchQTPM(const std::vector<std::string> &fileNames, const std::list<AutomatonSpec> &automata,
+                             const MonitorOptions &monitorOptions, const QTPMOptions &options,
+                             const std::string &inputFormat, const std::string &outputDirectory) {
+  if (!outputDirectory.empty()) {
+    // Two workers must not write the same result file
+    std::map<std::string, std::string> resultFileNames;
+    for (const std::string &fileName: fileNames) {
+      const auto inserted = resultFileNames.emplace(batchResultFileName(fileName, monitorOptions.resultFormat), fileName);
+      if (!inserted.second) {
+        throw std::runtime_error(fileName + ": the result file " + inserted.first->first + " is also the one of " + inserted.first->second);
+      }
     }
-    valuation.clear();
+  }
+  std::vector<BatchSummary> summaries(fileNames.size());
+  ThreadPool pool(std::min(options.jobs, fileNames.size()));
+  std::vector<std::future<void>> futures;
+  futures.reserve(fileNames.size());
+  for (std::size_t i = 0; i < fileNames.size(); i++) {
+    futures.push_back(pool.submit([&, i] {
+          const auto begin = std::chrono::steady_clock::now();
+          const std::string &fileName = fileNames[i];
+          const std::unique_ptr<FILE, int (*)(FILE *)> file(fopen(fileName.c_str(), "r"), fclose);
+          if (!file) {
+            throw std::runtime_error(fileName + ": " + std::strerror(errno));
+          }
+          std::unique_ptr<FILE, int (*)(FILE *)> out(nullptr, fclose);
+          const std::string resultFileName = outputDirectory + "/" + batchResultFileName(fileName, monitorOptions.resultFormat);
+          if (!outputDirectory.empty()) {
+            out.reset(fopen(resultFileName.c_str(), "wb"));
+            if (!out) {
+              throw std::runtime_error(resultFileName + ": " + std::strerror(errno));
+            }
+            const std::string resultHeader = ResultWriter::header(monitorOptions.resultFormat);
+            fwrite(resultHeader.data(), 1, resultHeader.size(), out.get());
+          }
+          {
+            // The monitors write the result before the file is closed
+            auto monitors = makeMonitors(automata, monitorOptions, out ? out.get() : stdout);
+            std::unique_ptr<SignalReader> reader = makeSignalReader(file.get(), fileName, inputFormat);
+            QTPMOptions fileOptions = options;
+            // The statistics of the files would be interleaved
+            fileOptions.printStats = false;
+            fileOptions.isAbsTime = reader->isAbsTime().value_or(options.isAbsTime);
+            if (!options.derivations.empty()) {
+              reader = std::make_unique<DerivedSignalReader>(std::move(reader), options.derivations, fileOptions.isAbsTime);
+            }
+            summaries[i].numOfPieces = QTPM(monitors, *reader, fileOptions);
+            for (const auto &monitor: monitors) {
+              summaries[i].peakNumOfConfigurations = std::max(summaries[i].peakNumOfConfigurations, monitor->getPeakNumOfConfigurations());
+            }
+          }
+          if (out && (fflush(out.get()) != 0 || ferror(out.get()))) {
+            throw std::runtime_error(resultFileName + ": " + std::strerror(errno));
+          }
+          summaries[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        }));
+  }
+
+  bool succeeded = true;
+  printf("file\tpieces\tseconds\tpeak_configurations\n");
+  for (std::size_t i = 0; i < fileNames.size(); i++) {
+    try {
+      futures[i].get();
+      printf("%s\t%zu\t%.3f\t%zu\n", fileNames[i].c_str(), summaries[i].numOfPieces, summaries[i].seconds, summaries[i].peakNumOfConfigurations);
+    } catch (const std::exception &e) {
+      fflush(stdout);
+      std::cerr << "qtpm: " << e.what() << std::endl;
+      succeeded = false;
+    }
+    fflush(stdout);
+  }
+  return succeeded;
+}
+
 
-    boost::unordered_map<std::array<Bounds, 6>, Weight>& result = qtpm.getResultRef();
-    if (!quiet) {
-      std::array<Bounds, 6> arr;
-      Weight weight;
-      BOOST_FOREACH(std::tie(arr, weight), result) {
-        printResult(fout, arr, weight.data);
+//! @brief The socket of the daemon removed when the daemon is terminated
+static std::string daemonSocketPath;
+
+static void terminateDaemon(int) {
+  unlink(daemonSocketPath.c_str());
+  _exit(0);
+}
+
+/*!
+  @brief Serve the monitoring sessions on the Unix domain socket until the daemon is terminated
+
+  The automata are parsed once and shared by the sessions, each served by its own thread.
+  @sa serveSession
+ */
+static inline void runDaemon(const std::string &path, const std::list<AutomatonSpec> &automata,
+                             const MonitorOptions &monitorOptions, QTPMOptions options) {
+  const int listener = listenUnixSocket(path);
+  daemonSocketPath = path;
+  std::signal(SIGINT, terminateDaemon);
+  std::signal(SIGTERM, terminateDaemon);
+  // A session whose client is gone fails in writing, not by the signal
+  std::signal(SIGPIPE, SIG_IGN);
+  // Each piece is matched as soon as it arrives
+  options.blockSize = 1;
+  options.printStats = false;
+  std::cerr << "qtpm: listening on " << path << std::endl;
+  for (std::size_t id = 0;; id++) {
+    const int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
       }
+      throw std::runtime_error(path + ": " + std::strerror(errno));
     }
-    result.clear();
+    std::thread(serveSession, fd, "session " + std::to_string(id), std::cref(automata), std::cref(monitorOptions), options).detach();
   }
 }
 
@@ -124,19 +331,40 @@ int main(int argc, char *argv[])
   // visible options
   options_description visible("description of options");
   std::string timedWordFileName;
-  std::string timedAutomatonFileName;
+  std::vector<std::string> timedAutomatonFileNames;
   visible.add_options()
     ("help,h", "help")
     ("quiet,q", "quiet")
+    ("output-format", value<std::string>()->default_value("text"), "format of the result: text, csv, jsonl, or binary")
+    ("output-thread", "write the result in a background thread")
+    ("threads", value<std::size_t>()->default_value(1), "the number of the threads of the pipeline reader -> matcher -> writer. 2: read the signal in its own thread. 3: also write the result in its own thread")
+    ("stats", "print the statistics of the pipeline to stderr")
     ("version,V", "version")
     ("input,i", value<std::string>(&timedWordFileName)->default_value("stdin"),"input file of the signal")
-    ("automaton,f", value<std::string>(&timedAutomatonFileName)->default_value(""),"input file of timed symbolic automaton")
+    ("input-format", value<std::string>()->default_value("text"), "format of the signal: text or binary")
+    ("derive", value<std::vector<std::string>>()->composing(), "append a signal variable derived over a sliding window: diff(xI,W), mean(xI,W), min(xI,W), or max(xI,W). It can be given multiple times and overrides the \"derive\" attribute of the automaton")
+    ("batch", value<std::vector<std::string>>()->composing(), "batch mode. Match each signal file, or each file in the directory, in parallel by --jobs threads and print a summary line per file. It can be given multiple times")
+    ("output-dir", value<std::string>(), "the directory of the result file of each signal in the batch mode")
+    ("daemon", value<std::string>(), "daemon mode. Serve the monitoring sessions of the binary signals on the Unix domain socket at the path (see qtpm-client)")
+    ("automaton,f", value<std::vector<std::string>>(&timedAutomatonFileNames)->composing(),"input file of timed symbolic automaton. It can be given multiple times as FILE[:SEMIRING] to monitor several automata at once")
+    ("compile-automaton", "write the binary image FILE.qtpmc of each automaton, which is loaded instead of FILE while it is newer, and exit")
+    ("no-automaton-cache", "always parse the automata ignoring their binary images")
+    ("no-preprocess", "use the automata as they are without removing the useless states and transitions, merging the equivalent states, and renumbering the clock variables")
     ("abs,a", "absolute time mode")
     ("maxmin", "use maxmin semiring space robustness (default)")
     ("minplus", "use minplus semiring space robustness")
     ("maxplus", "use maxplus semiring space robustness")
     ("boolean", "use boolean semiring space robustness")
-    ("ignore-zero", "Ignore zero of the semiring");
+    ("ignore-zero", "Ignore zero of the semiring")
+    ("stream", "streaming mode. Each matching is printed once it is finalized")
+    ("threshold", value<double>(), "only report the matching whose weight is at least the threshold (maxmin and boolean only)")
+    ("checkpoint", value<std::string>(), "write the state of the matching to the file at the end of the signal")
+    ("checkpoint-interval", value<std::size_t>()->default_value(0), "also write the checkpoint every N pieces")
+    ("resume", value<std::string>(), "resume the matching from the checkpoint file")
+    ("max-configurations", value<std::size_t>()->default_value(0), "over-approximate the configurations when their number exceeds N (0: no limit)")
+    ("memory-budget", value<std::string>(), "over-approximate the configurations when their estimated memory usage exceeds SIZE, e.g., 512M")
+    ("latency-budget", value<double>()->default_value(0), "switch to the degraded mode when a piece takes longer than SECONDS (0: no limit)")
+    ("jobs,j", value<std::size_t>()->default_value(1), "the number of the threads. With multiple automata, they are fed in parallel. With one automaton bounding the duration of the matching, the signal is split into chunks processed in parallel");
 
   command_line_parser parser(argc, argv);
   parser.options(visible);
@@ -145,7 +373,7 @@ int main(int argc, char *argv[])
   store(parseResult, vm);
   notify(vm);
 
-  if (timedAutomatonFileName.empty() || vm.count("help")) {
+  if (timedAutomatonFileNames.empty() || vm.count("help")) {
     std::cout << programName << " [OPTIONS] -f FILE [FILE]\n" 
               << visible << std::endl;
     return 0;
@@ -156,15 +384,163 @@ int main(int argc, char *argv[])
     return 0;
   }
 
-  using SignalVariables = uint8_t;
-  using ClockVariables = uint8_t;
+  const std::string defaultSemiring = vm.count("minplus") ? "minplus" :
+    vm.count("maxplus") ? "maxplus" :
+    vm.count("boolean") ? "boolean" : "maxmin";
+  MonitorOptions monitorOptions = {bool(vm.count("quiet")), bool(vm.count("stream")), bool(vm.count("ignore-zero")), boost::none};
+  if (vm.count("threshold")) {
+    monitorOptions.threshold = vm["threshold"].as<double>();
+  }
+  monitorOptions.maxConfigurations = vm["max-configurations"].as<std::size_t>();
+  monitorOptions.latencyBudget = vm["latency-budget"].as<double>();
+  if (vm.count("memory-budget")) {
+    const auto memoryBudget = parseSize(vm["memory-budget"].as<std::string>());
+    if (!memoryBudget) {
+      std::cerr << programName << ": invalid memory budget: " << vm["memory-budget"].as<std::string>() << std::endl;
+      exit(1);
+    }
+    monitorOptions.memoryBudget = *memoryBudget;
+  }
+  const std::string inputFormat = vm["input-format"].as<std::string>();
+  if (!isSignalFormatName(inputFormat)) {
+    std::cerr << programName << ": unknown input format: " << inputFormat << std::endl;
+    exit(1);
+  }
+  QTPMOptions options = {bool(vm.count("abs")),
+                               vm.count("checkpoint") ? vm["checkpoint"].as<std::string>() : "",
+                               vm["checkpoint-interval"].as<std::size_t>(),
+                               std::max<std::size_t>(1, vm["jobs"].as<std::size_t>()),
+                               // Each piece from stdin is fed as soon as it arrives for online monitoring
+                               timedWordFileName == "stdin" ? std::size_t(1) : std::size_t(1024)};
+
+  if (timedAutomatonFileNames.size() > 1 && (vm.count("checkpoint") || vm.count("resume"))) {
+    std::cerr << programName << ": checkpoints are not supported with multiple automata" << std::endl;
+    exit(1);
+  }
+  const bool isBatch = vm.count("batch");
+  if (isBatch && (vm.count("checkpoint") || vm.count("resume"))) {
+    std::cerr << programName << ": checkpoints are not supported in the batch mode" << std::endl;
+    exit(1);
+  }
+  const bool isDaemon = vm.count("daemon");
+  if (isDaemon && (isBatch || vm.count("checkpoint") || vm.count("resume"))) {
+    std::cerr << programName << ": the daemon mode does not support the batch mode or checkpoints" << std::endl;
+    exit(1);
+  }
+  if (isBatch && !vm.count("output-dir") && !monitorOptions.quiet) {
+    std::cerr << programName << ": the batch mode requires --output-dir unless --quiet is given" << std::endl;
+    exit(1);
+  }
+
+  const auto resultFormat = parseResultFormat(vm["output-format"].as<std::string>());
+  if (!resultFormat) {
+    std::cerr << programName << ": unknown output format: " << vm["output-format"].as<std::string>() << std::endl;
+    exit(1);
+  }
+  monitorOptions.resultFormat = *resultFormat;
+  options.threads = std::max<std::size_t>(1, vm["threads"].as<std::size_t>());
+  options.printStats = vm.count("stats");
+  // The output thread must live as long as the monitors. It takes the result from one thread, so it is not used with multiple automata in parallel, where the result is buffered in memory and written by the main thread, or in the batch and daemon modes.
+  std::unique_ptr<OutputThread> outputThread;
+  if ((vm.count("output-thread") || options.threads > 2) && !(options.jobs > 1 && timedAutomatonFileNames.size() > 1) && !isBatch && !isDaemon) {
+    outputThread = std::make_unique<OutputThread>();
+    monitorOptions.outputThread = outputThread.get();
+  }
+
+  // The automata must live as long as the monitors
+  std::list<AutomatonSpec> automata;
+  for (const std::string &spec: timedAutomatonFileNames) {
+    // FILE[:SEMIRING]
+    std::string timedAutomatonFileName = spec;
+    std::string semiring = defaultSemiring;
+    const auto colon = spec.rfind(':');
+    if (colon != std::string::npos && isSemiringName(spec.substr(colon + 1))) {
+      timedAutomatonFileName = spec.substr(0, colon);
+      semiring = spec.substr(colon + 1);
+    }
+    if (monitorOptions.threshold && !isMonotoneSemiring(semiring)) {
+      std::cerr << programName << ": --threshold requires a monotone semiring, i.e., maxmin or boolean" << std::endl;
+      exit(1);
+    }
+
+    // parse TA
+    automata.emplace_back();
+    automata.back().name = spec;
+    automata.back().semiring = semiring;
+    try {
+      loadBoostTA(timedAutomatonFileName, automata.back().TA, automata.back().initStates, !vm.count("no-automaton-cache"));
+      if (vm.count("compile-automaton")) {
+        writeAutomatonCache(automatonCacheFileName(timedAutomatonFileName), automata.back().TA);
+      }
+      if (!vm.count("compile-automaton") && !vm.count("no-preprocess")) {
+        const PreprocessingReport report = preprocessBoostTA(automata.back().TA, automata.back().initStates);
+        if (options.printStats) {
+          printPreprocessingReport(spec, report);
+        }
+      }
+    } catch (const std::exception &e) {
+      std::cerr << programName << ": " << e.what() << std::endl;
+      exit(1);
+    }
+  }
+  if (vm.count("compile-automaton")) {
+    return 0;
+  }
+
+  // The derivations on the command line override the ones in the automata
+  try {
+    if (vm.count("derive")) {
+      for (const std::string &spec: vm["derive"].as<std::vector<std::string>>()) {
+        const auto derivations = parseDerivations(spec);
+        options.derivations.insert(options.derivations.end(), derivations.begin(), derivations.end());
+      }
+    } else {
+      for (const AutomatonSpec &automaton: automata) {
+        const auto derivations = parseDerivations(boost::get_property(automaton.TA, boost::graph_derive));
+        if (!derivations.empty() && !options.derivations.empty() && derivations != options.derivations) {
+          throw std::runtime_error("the automata derive different signal variables");
+        } else if (!derivations.empty()) {
+          options.derivations = derivations;
+        }
+      }
+    }
+  } catch (const std::runtime_error &e) {
+    std::cerr << programName << ": " << e.what() << std::endl;
+    exit(1);
+  }
 
-  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
-  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  if (isBatch) {
+    try {
+      const std::vector<std::string> fileNames = listBatchFiles(vm["batch"].as<std::vector<std::string>>());
+      return batchQTPM(fileNames, automata, monitorOptions, options, inputFormat,
+                       vm.count("output-dir") && !monitorOptions.quiet ? vm["output-dir"].as<std::string>() : "") ? 0 : 1;
+    } catch (const std::runtime_error &e) {
+      std::cerr << programName << ": " << e.what() << std::endl;
+      exit(1);
+    }
+  }
+
+  if (isDaemon) {
+    try {
+      runDaemon(vm["daemon"].as<std::string>(), automata, monitorOptions, options);
+    } catch (const std::runtime_error &e) {
+      std::cerr << programName << ": " << e.what() << std::endl;
+      exit(1);
+    }
+  }
 
-  // parse TA
-  std::ifstream taStream(timedAutomatonFileName);
-  parseBoostTA(taStream, TA, initStates);
+  const std::string resultHeader = ResultWriter::header(*resultFormat);
+  fwrite(resultHeader.data(), 1, resultHeader.size(), stdout);
+  std::vector<MonitorPtr> monitors = makeMonitors(automata, monitorOptions, stdout);
+
+  if (vm.count("resume")) {
+    const std::string &resumeFileName = vm["resume"].as<std::string>();
+    std::ifstream is(resumeFileName, std::ios::binary);
+    if (!is || !monitors.front()->loadCheckpoint(is)) {
+      std::cerr << "Failed to load the checkpoint: " << resumeFileName << std::endl;
+      exit(1);
+    }
+  }
 
   FILE* file = timedWordFileName == "stdin" ? stdin : fopen(timedWordFileName.c_str(), "r");
   // Error handling for file open
@@ -174,29 +550,44 @@ int main(int argc, char *argv[])
 
     exit(1);
   }
-  using Value = double;
-
-  // TODO: branching by semirings
-  if (vm.count("minplus")) {
-    using Weight = MinPlusSemiring<Value>;
-    std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables>;
-    QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> qtpm(TA, initStates, cost, vm.count("ignore-zero"));
-    QTPM(qtpm, file, stdout, vm.count("quiet"), vm.count("abs"));
-  } else if (vm.count("maxplus")) {
-    using Weight = MaxPlusSemiring<Value>;
-    std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables>;
-    QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> qtpm(TA, initStates, cost, vm.count("ignore-zero"));
-    QTPM(qtpm, file, stdout, vm.count("quiet"), vm.count("abs"));
-  } else if (vm.count("boolean")) {
-    using Weight = BooleanSemiring;
-    std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables>;
-    QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> qtpm(TA, initStates, cost, vm.count("ignore-zero"));
-    QTPM(qtpm, file, stdout, vm.count("quiet"), vm.count("abs"));
-  } else {
-    using Weight = MaxMinSemiring<Value>;
-    std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables>;
-    QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> qtpm(TA, initStates, cost, vm.count("ignore-zero"));
-    QTPM(qtpm, file, stdout, vm.count("quiet"), vm.count("abs"));
+
+  try {
+    std::unique_ptr<SignalReader> readerPtr = makeSignalReader(file, timedWordFileName, inputFormat);
+    // The time mode in the binary signal overrides --abs
+    options.isAbsTime = readerPtr->isAbsTime().value_or(options.isAbsTime);
+    if (!options.derivations.empty()) {
+      readerPtr = std::make_unique<DerivedSignalReader>(std::move(readerPtr), options.derivations, options.isAbsTime);
+    }
+    SignalReader &reader = *readerPtr;
+    struct stat st;
+    // The chunks need the entire signal, which would stop the online monitoring of a pipe until its end
+    const bool isOffline = fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode);
+    if (options.jobs > 1 && monitors.size() > 1) {
+      parallelQTPM(monitors, reader, stdout, options);
+    } else if (options.jobs > 1 && monitors.front()->getMaxMatchDuration() && isOffline && !monitorOptions.isStream &&
+               monitorOptions.latencyBudget <= 0 && options.checkpointFileName.empty() && !vm.count("resume")) {
+      chunkedQTPM(*monitors.front(), reader, options);
+    } else {
+      if (options.jobs > 1) {
+        std::cerr << programName << ": the duration of the matching is not bounded by the automaton, the signal is not a regular file, or --stream, --latency-budget, or a checkpoint is used. The signal is processed sequentially." << std::endl;
+      }
+      QTPM(monitors, reader, options);
+    }
+  } catch (const std::runtime_error &e) {
+    fflush(stdout);
+    std::cerr << programName << ": " << e.what() << std::endl;
+    exit(1);
+  }
+
+  for (const auto &monitor: monitors) {
+    if (monitor->getNumOfApproximations() > 0) {
+      std::cerr << programName << ": the configurations were over-approximated after " << monitor->getNumOfApproximations()
+                << " pieces and " << monitor->getNumOfMergedConfigurations() << " configurations were merged" << std::endl;
+    }
+  }
+  if (outputThread && options.printStats) {
+    outputThread->finish();
+    printStageStats("matcher -> writer", outputThread->getStats(), outputThread->capacity());
   }
 
   return 0;
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <boost/optional.hpp>
+
+#include "chunked_matching.hh"
+#include "piece_coalescer.hh"
+#include "quantitative_timed_pattern_matching.hh"
+#include "result_writer.hh"
+#include "robustness.hh"
+#include "timed_automaton_analysis.hh"
+
+//! @brief The options of a monitor independent of the semiring
+struct MonitorOptions {
+  bool quiet;
+  bool isStream;
+  bool ignoreZero;
+  //! @brief The threshold of the weight. It is used only for the monotone semirings.
+  boost::optional<double> threshold;
+  //! @brief The maximum number of the configurations before the over-approximation. 0 means no limit.
+  std::size_t maxConfigurations = 0;
+  //! @brief The maximum estimated memory usage of the configurations in bytes. 0 means no limit.
+  std::size_t memoryBudget = 0;
+  //! @brief The maximum processing time of each piece in seconds. 0 means no limit.
+  double latencyBudget = 0;
+  ResultFormat resultFormat = ResultFormat::text;
+  //! @brief The thread writing the result. If it is nullptr, the result is written by the thread feeding the signal.
+  OutputThread *outputThread = nullptr;
+};
+
+/*!
+  @brief The interface of a matcher hiding its semiring
+
+  This is used to feed the same signal to the matchers of several automata, each with its own semiring.
+ */
+template<class SignalVariables, class ClockVariables, class Value>
+class Monitor {
+public:
+  virtual ~Monitor() {}
+  //! @brief Feed one piece of the signal
+  virtual void feed(const std::vector<Value> &valuation, double duration) = 0;
+  /*!
+    @brief Feed a block of pieces given by columns
+
+    @sa QuantitativeTimedPatternMatching::feedBatch
+   */
+  virtual void feedBatch(std::size_t size, const double *durations, const std::vector<const Value*> &columns) = 0;
+  //! @brief Print the matching reported so far and remove them. In the streaming mode, the finalized matching is already printed in @ref feed.
+  virtual void printResult() = 0;
+  //! @brief Print all the remaining matching at the end of the signal
+  virtual void flushResult() = 0;
+  //! @brief Write the checkpoint. The pieces buffered in the monitor, e.g., a pending run of the coalescing, are fed first.
+  virtual void saveCheckpoint(std::ostream &os) = 0;
+  virtual bool loadCheckpoint(std::istream &is) = 0;
+  virtual double getAbsTime() const = 0;
+  virtual std::size_t getNumOfConfigurations() const = 0;
+  //! @brief The maximum number of the configurations after a piece fed so far
+  virtual std::size_t getPeakNumOfConfigurations() const = 0;
+  //! @brief The number of the pieces after which the configurations are over-approximated
+  virtual std::size_t getNumOfApproximations() const = 0;
+  //! @brief The number of the configurations removed by the over-approximation in total
+  virtual std::size_t getNumOfMergedConfigurations() const = 0;
+  //! @brief Change the file to print the result to
+  virtual void setOutput(FILE *newOut) = 0;
+  //! @brief An upper bound of the duration of any matching. It is boost::none if the automaton does not bound it.
+  virtual boost::optional<double> getMaxMatchDuration() const = 0;
+  /*!
+    @brief Match the entire signal by chunks in parallel and print the result
+
+    @pre getMaxMatchDuration() is not boost::none and no piece is fed yet
+    @sa chunkedMatching
+   */
+  virtual void feedInChunks(const std::vector<std::vector<Value>> &valuations, const std::vector<double> &durations,
+                            ThreadPool &pool, std::size_t numOfChunks) = 0;
+};
+
+//! @brief The monitor with the semiring Weight
+template<class SignalVariables, class ClockVariables, class Value, class Weight>
+class SemiringMonitor : public Monitor<SignalVariables, ClockVariables, Value> {
+public:
+  using TimedAutomaton = BoostTimedAutomaton<SignalVariables, ClockVariables>;
+
+  SemiringMonitor(const TimedAutomaton &TA,
+                  const std::vector<typename TimedAutomaton::vertex_descriptor> &initStates,
+                  const MonitorOptions &options, FILE *out, std::string tag) :
+    qtpm(TA, initStates, multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>, options.ignoreZero),
+    maxDuration(maxMatchDuration(TA, initStates)),
+    quiet(options.quiet), isStream(options.isStream), writer(out, options.resultFormat, std::move(tag), options.outputThread) {
+    if (std::is_same<Weight, BooleanSemiring>::value) {
+      // Only the truth values of the constraints matter in the Boolean semantics
+      coalescer = std::make_unique<BooleanPieceCoalescer<SignalVariables, Value>>(TA);
+    }
+    // The cost is multipleSpaceRobustness
+    qtpm.useLabelTable(true);
+    qtpm.setMaxConfigurations(options.maxConfigurations);
+    qtpm.setMemoryBudget(options.memoryBudget);
+    qtpm.setLatencyBudget(options.latencyBudget);
+    if (semiring_traits<Weight>::is_monotone && options.threshold) {
+      qtpm.setThreshold(Weight(*options.threshold));
+    }
+    if (isStream) {
+      // The matching is printed only after it is finalized by the watermark
+      qtpm.setResultSink(makeSink());
+    }
+  }
+
+  void feed(const std::vector<Value> &valuation, double duration) override {
+    if (!coalescer) {
+      qtpm.feed(valuation, duration);
+      return;
+    }
+    // The piece may continue the pending run of the coalescer
+    singleColumns.resize(valuation.size());
+    for (std::size_t j = 0; j < valuation.size(); j++) {
+      singleColumns[j] = &valuation[j];
+    }
+    feedBatch(1, &duration, singleColumns);
+  }
+
+  void feedBatch(std::size_t size, const double *durations, const std::vector<const Value*> &columns) override {
+    if (!coalescer) {
+      qtpm.feedBatch(size, durations, columns);
+      return;
+    }
+    if (coalescer->getPendingWidth() != columns.size()) {
+      // The number of the signal variables changed
+      feedPending();
+    }
+    const std::size_t mergedSize = coalescer->coalesce(size, durations, columns, mergedDurations, mergedColumns);
+    mergedColumnPointers.resize(mergedColumns.size());
+    for (std::size_t j = 0; j < mergedColumns.size(); j++) {
+      mergedColumnPointers[j] = mergedColumns[j].data();
+    }
+    qtpm.feedBatch(mergedSize, mergedDurations.data(), mergedColumnPointers);
+  }
+
+  void printResult() override {
+    printDegradedIntervals();
+    if (isStream) {
+      writer.flush();
+      return;
+    }
+    writeResult();
+    writer.flush();
+  }
+
+  void flushResult() override {
+    feedPending();
+    if (!isStream) {
+      // Without the sink, the matching found in the pending run is only in the result of qtpm
+      writeResult();
+    }
+    qtpm.flushResult();
+    printDegradedIntervals();
+    writer.flush();
+  }
+
+  void saveCheckpoint(std::ostream &os) override {
+    // The checkpoint does not keep the pending run
+    feedPending();
+    qtpm.saveCheckpoint(os);
+  }
+
+  bool loadCheckpoint(std::istream &is) override {
+    return qtpm.loadCheckpoint(is);
+  }
+
+  double getAbsTime() const override {
+    return qtpm.getAbsTime() + (coalescer ? coalescer->getPendingDuration() : 0);
+  }
+
+  std::size_t getNumOfConfigurations() const override {
+    return qtpm.getNumOfConfigurations();
+  }
+
+  std::size_t getPeakNumOfConfigurations() const override {
+    return qtpm.getPeakNumOfConfigurations();
+  }
+
+  std::size_t getNumOfApproximations() const override {
+    return qtpm.getNumOfApproximations() + chunkApproximations.first;
+  }
+
+  std::size_t getNumOfMergedConfigurations() const override {
+    return qtpm.getNumOfMergedConfigurations() + chunkApproximations.second;
+  }
+
+  void setOutput(FILE *newOut) override {
+    writer.setOutput(newOut);
+  }
+
+  boost::optional<double> getMaxMatchDuration() const override {
+    return maxDuration;
+  }
+
+  void feedInChunks(const std::vector<std::vector<Value>> &valuations, const std::vector<double> &durations,
+                    ThreadPool &pool, std::size_t numOfChunks) override {
+    if (coalescer) {
+      std::vector<std::vector<Value>> mergedValuations;
+      coalescer->coalesce(valuations, durations, mergedValuations, mergedDurations);
+      chunkApproximations = chunkedMatching(qtpm, mergedValuations, mergedDurations, *maxDuration, pool, numOfChunks, makeSink());
+    } else {
+      chunkApproximations = chunkedMatching(qtpm, valuations, durations, *maxDuration, pool, numOfChunks, makeSink());
+    }
+    writer.flush();
+  }
+
+private:
+  QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> qtpm;
+  const boost::optional<double> maxDuration;
+  const bool quiet;
+  const bool isStream;
+  ResultWriter writer;
+  //! @brief The coalescer of the pieces. It is used only in the Boolean semantics.
+  std::unique_ptr<BooleanPieceCoalescer<SignalVariables, Value>> coalescer;
+  // buffers of the merged pieces
+  std::vector<double> mergedDurations;
+  std::vector<std::vector<Value>> mergedColumns;
+  std::vector<const Value*> mergedColumnPointers;
+  //! @brief The columns of the piece given to @ref feed
+  std::vector<const Value*> singleColumns;
+  //! @brief The numbers of the over-approximations and the removed configurations in @ref feedInChunks
+  std::pair<std::size_t, std::size_t> chunkApproximations = {0, 0};
+
+  //! @brief Feed the pending run of the coalescer if any
+  void feedPending() {
+    if (!coalescer) {
+      return;
+    }
+    const std::size_t mergedSize = coalescer->flush(mergedDurations, mergedColumns);
+    if (mergedSize == 0) {
+      return;
+    }
+    mergedColumnPointers.resize(mergedColumns.size());
+    for (std::size_t j = 0; j < mergedColumns.size(); j++) {
+      mergedColumnPointers[j] = mergedColumns[j].data();
+    }
+    qtpm.feedBatch(mergedSize, mergedDurations.data(), mergedColumnPointers);
+  }
+
+  //! @brief Print the matching in the result of qtpm and remove them
+  void writeResult() {
+    auto &result = qtpm.getResultRef();
+    if (!quiet) {
+      for (const auto &r: result) {
+        writer.writeMatch(r.first, r.second.data, qtpm.isApproximate(r.first));
+      }
+    }
+    result.clear();
+  }
+
+  //! @brief Print the degraded intervals finished so far and remove them
+  void printDegradedIntervals() {
+    auto &intervals = qtpm.getDegradedIntervalsRef();
+    if (!quiet) {
+      for (const auto &interval: intervals) {
+        writer.writeDegraded(interval.first, interval.second);
+      }
+    }
+    intervals.clear();
+  }
+
+  //! @brief The sink writing the matching
+  typename QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value>::ResultSink makeSink() {
+    return [this] (const std::array<Bounds, 6> &arr, const Weight &weight, bool approximate) {
+      if (!quiet) {
+        writer.writeMatch(arr, weight.data, approximate);
+      }
+    };
+  }
+};
+
+/*!
+  @brief Make a monitor with the semiring of the given name
+
+  @param [in] semiring One of "maxmin", "minplus", "maxplus", and "boolean"
+  @returns The monitor. If the name of the semiring is unknown, nullptr is returned.
+ */
+template<class SignalVariables, class ClockVariables, class Value>
+std::unique_ptr<Monitor<SignalVariables, ClockVariables, Value>>
+makeMonitor(const std::string &semiring,
+            const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA,
+            const std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> &initStates,
+            const MonitorOptions &options, FILE *out, const std::string &tag = "") {
+  if (semiring == "maxmin") {
+    return std::make_unique<SemiringMonitor<SignalVariables, ClockVariables, Value, MaxMinSemiring<Value>>>(TA, initStates, options, out, tag);
+  } else if (semiring == "minplus") {
+    return std::make_unique<SemiringMonitor<SignalVariables, ClockVariables, Value, MinPlusSemiring<Value>>>(TA, initStates, options, out, tag);
+  } else if (semiring == "maxplus") {
+    return std::make_unique<SemiringMonitor<SignalVariables, ClockVariables, Value, MaxPlusSemiring<Value>>>(TA, initStates, options, out, tag);
+  } else if (semiring == "boolean") {
+    return std::make_unique<SemiringMonitor<SignalVariables, ClockVariables, Value, BooleanSemiring>>(TA, initStates, options, out, tag);
+  }
+  return nullptr;
+}
+
+//! @brief Check if the given name is a name of a supported semiring
+static inline bool isSemiringName(const std::string &semiring) {
+  return semiring == "maxmin" || semiring == "minplus" || semiring == "maxplus" || semiring == "boolean";
+}
+
+//! @brief Check if the semiring of the given name is monotone, i.e., if it supports the threshold
+static inline bool isMonotoneSemiring(const std::string &semiring) {
+  return semiring == "maxmin" || semiring == "boolean";
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "robustness.hh"
+#include "timed_automaton.hh"
+#include "weighted_graph.hh"
+
+/*!
+  @brief Merge the consecutive pieces of a signal indistinguishable in the Boolean semantics
+
+  In the Boolean semantics, a piece of the signal matters only through the truth value of each atomic constraint in the labels of the timed automaton. Thus, the consecutive pieces with the same truth values of all the atomic constraints can be merged into one piece with the summed duration without changing the matching.
+ */
+template<class SignalVariables, class Value>
+class BooleanPieceCoalescer {
+public:
+  template<class ClockVariables>
+  explicit BooleanPieceCoalescer(const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA) {
+    for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+      for (const auto &constraint: TA[*range.first].label) {
+        if (std::none_of(atoms.begin(), atoms.end(), [&](const std::vector<Constraint<SignalVariables>> &atom) {
+              return atom.front().x == constraint.x && atom.front().odr == constraint.odr && atom.front().c == constraint.c;
+            })) {
+          atoms.push_back({constraint});
+        }
+      }
+    }
+  }
+
+  //! @brief The number of the distinct atomic constraints in the labels
+  std::size_t getNumOfAtoms() const {
+    return atoms.size();
+  }
+
+  /*!
+    @brief Merge the consecutive pieces with the same truth values
+
+    Each merged piece has the valuation of its first piece and the summed duration. The last run of the pieces may continue in the next call, so it is kept pending over the calls and given only after a piece with other truth values arrives or by @ref flush. Thus, the runs are merged across the blocks of the pieces, e.g., with a block of one piece in the online monitoring.
+
+    @param [in] size The number of the pieces
+    @param [in] durations The duration of each piece
+    @param [in] columns columns[j][i] is the value of the j-th signal variable in the i-th piece
+    @param [out] mergedDurations The duration of each merged piece
+    @param [out] mergedColumns The merged pieces by columns
+    @pre The number of the signal variables is the same as the pending run if any (see @ref getPendingWidth)
+    @returns The number of the merged pieces, which is at most size
+   */
+  std::size_t coalesce(const std::size_t size, const double *durations, const std::vector<const Value*> &columns,
+                       std::vector<double> &mergedDurations, std::vector<std::vector<Value>> &mergedColumns) {
+    mergedDurations.resize(size);
+    mergedColumns.resize(columns.size());
+    for (auto &column: mergedColumns) {
+      column.resize(size);
+    }
+    std::size_t mergedSize = 0;
+    for (std::size_t i = 0; i < size; i++) {
+      valuation.resize(columns.size());
+      for (std::size_t j = 0; j < columns.size(); j++) {
+        valuation[j] = columns[j][i];
+      }
+      evaluate(valuation, truth);
+      if (hasPending && truth == pendingTruth) {
+        pendingDuration += durations[i];
+        continue;
+      }
+      if (hasPending) {
+        mergedDurations[mergedSize] = pendingDuration;
+        for (std::size_t j = 0; j < columns.size(); j++) {
+          mergedColumns[j][mergedSize] = pendingValuation[j];
+        }
+        mergedSize++;
+      }
+      std::swap(valuation, pendingValuation);
+      std::swap(truth, pendingTruth);
+      pendingDuration = durations[i];
+      hasPending = true;
+    }
+    return mergedSize;
+  }
+
+  /*!
+    @brief Give the pending run, e.g., at the end of the signal or before a checkpoint
+
+    @returns The number of the merged pieces, which is 0 or 1
+   */
+  std::size_t flush(std::vector<double> &mergedDurations, std::vector<std::vector<Value>> &mergedColumns) {
+    if (!hasPending) {
+      return 0;
+    }
+    mergedDurations.resize(1);
+    mergedDurations[0] = pendingDuration;
+    mergedColumns.resize(pendingValuation.size());
+    for (std::size_t j = 0; j < pendingValuation.size(); j++) {
+      mergedColumns[j].resize(1);
+      mergedColumns[j][0] = pendingValuation[j];
+    }
+    hasPending = false;
+    return 1;
+  }
+
+  //! @brief The number of the signal variables of the pending run. It is 0 if no run is pending.
+  std::size_t getPendingWidth() const {
+    return hasPending ? pendingValuation.size() : 0;
+  }
+
+  //! @brief The duration of the pending run. It is 0 if no run is pending.
+  double getPendingDuration() const {
+    return hasPending ? pendingDuration : 0;
+  }
+
+  /*!
+    @brief Merge the consecutive pieces with the same truth values given by rows
+
+    The pieces are the entire signal, so no run is kept pending. This is independent of the pending run of the columnar @ref coalesce.
+   */
+  void coalesce(const std::vector<std::vector<Value>> &valuations, const std::vector<double> &durations,
+                std::vector<std::vector<Value>> &mergedValuations, std::vector<double> &mergedDurations) {
+    mergedValuations.clear();
+    mergedDurations.clear();
+    std::vector<bool> lastTruth;
+    for (std::size_t i = 0; i < valuations.size(); i++) {
+      evaluate(valuations[i], truth);
+      if (!mergedDurations.empty() && truth == lastTruth) {
+        mergedDurations.back() += durations[i];
+        continue;
+      }
+      mergedValuations.push_back(valuations[i]);
+      mergedDurations.push_back(durations[i]);
+      std::swap(truth, lastTruth);
+    }
+  }
+
+private:
+  //! @brief Each atomic constraint as a label with one constraint
+  std::vector<std::vector<Constraint<SignalVariables>>> atoms;
+  // buffers reused over the pieces
+  std::vector<Value> valuation;
+  std::vector<bool> truth;
+  //! @brief If the last run of the pieces is not given yet
+  bool hasPending = false;
+  //! @brief The valuation of the first piece of the pending run
+  std::vector<Value> pendingValuation;
+  //! @brief The truth values of the pending run
+  std::vector<bool> pendingTruth;
+  //! @brief The summed duration of the pending run
+  double pendingDuration = 0;
+
+  void evaluate(const std::vector<Value> &valuation, std::vector<bool> &truth) const {
+    truth.resize(atoms.size());
+    for (std::size_t k = 0; k < atoms.size(); k++) {
+      // The same evaluation as the cost function in the Boolean semantics
+      truth[k] = singleSpaceRobustness<BooleanSemiring, Value>(atoms[k], valuation).data;
+    }
+  }
+};
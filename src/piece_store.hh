@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+
+/*!
+  @brief The pieces [begin, end) of a signal by their indices since the beginning of the signal
+
+  This is the history of a configuration, i.e., the pieces observed after the latest transition, given as a range of @ref PieceStore. The histories compared with each other always end with the same (i.e., the current) piece unless they are empty. Thus, two non-empty histories have the same valuations if and only if they have the same ranges and we do not have to compare the valuations.
+ */
+struct PieceRange {
+  std::size_t begin = 0;
+  std::size_t end = 0;
+
+  std::size_t size() const {
+    return end - begin;
+  }
+
+  bool empty() const {
+    return begin == end;
+  }
+
+  /*!
+    @brief The range after observing the piece of the given index
+
+    @pre The range is empty or it ends just before the index.
+   */
+  PieceRange extendedTo(std::size_t index) const {
+    return PieceRange{empty() ? index : begin, index + 1};
+  }
+
+  //! @brief The empty ranges are the same regardless of their position
+  bool operator==(const PieceRange &other) const {
+    return size() == other.size() && (empty() || begin == other.begin);
+  }
+
+  bool operator!=(const PieceRange &other) const {
+    return !(*this == other);
+  }
+};
+
+static inline std::size_t hash_value(const PieceRange &range) {
+  if (range.empty()) {
+    return 0;
+  }
+  std::size_t seed = range.begin;
+  boost::hash_combine(seed, range.end);
+  return seed;
+}
+
+/*!
+  @brief The pieces of a signal shared by the configurations of a matcher
+
+  The pieces are kept in a ring buffer of slots and referred to by their indices since the beginning of the signal. The old pieces no longer referred to are discarded by @ref discardBefore and their slots are reused, so that the memory for the valuations is allocated only when the buffer grows.
+ */
+template<class Value>
+class PieceStore {
+public:
+  /*!
+    @brief Append a piece
+
+    @returns The index of the piece
+   */
+  std::size_t push(const std::vector<Value> &valuation) {
+    if (end - begin == slots.size()) {
+      // Grow the buffer keeping the position of each piece
+      std::vector<std::vector<Value>> newSlots(std::max<std::size_t>(4, slots.size() * 2));
+      for (std::size_t i = begin; i < end; i++) {
+        std::swap(newSlots[i % newSlots.size()], slots[i % slots.size()]);
+      }
+      slots = std::move(newSlots);
+    }
+    slots[end % slots.size()] = valuation;
+    return end++;
+  }
+
+  //! @brief The valuation of the piece of the given index
+  const std::vector<Value> &operator[](std::size_t index) const {
+#ifdef DEBUG
+    assert(begin <= index && index < end);
+#endif
+    return slots[index % slots.size()];
+  }
+
+  //! @brief The index of the oldest piece kept
+  std::size_t getBegin() const {
+    return begin;
+  }
+
+  //! @brief The number of the pieces appended so far, i.e., the index of the next piece
+  std::size_t getEnd() const {
+    return end;
+  }
+
+  //! @brief Discard the pieces before the given index
+  void discardBefore(std::size_t index) {
+    begin = std::max(begin, std::min(index, end));
+  }
+
+  //! @brief The memory usage of the kept pieces in bytes
+  std::size_t getMemoryUsage() const {
+    std::size_t usage = slots.capacity() * sizeof(std::vector<Value>);
+    for (const auto &slot: slots) {
+      usage += slot.capacity() * sizeof(Value);
+    }
+    return usage;
+  }
+
+private:
+  std::vector<std::vector<Value>> slots;
+  std::size_t begin = 0;
+  std::size_t end = 0;
+};
+
+/*!
+  @brief The valuations of a range of pieces in a PieceStore
+
+  This is a light view given to the cost function in place of a vector of the valuations. It is valid while the pieces in the range are kept in the store.
+ */
+template<class Value>
+class PieceHistory {
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::vector<Value>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::vector<Value>*;
+    using reference = const std::vector<Value>&;
+
+    const_iterator(const PieceStore<Value> &store, std::size_t index) : store(&store), index(index) {}
+    reference operator*() const {
+      return (*store)[index];
+    }
+    pointer operator->() const {
+      return &(*store)[index];
+    }
+    const_iterator &operator++() {
+      index++;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      index++;
+      return old;
+    }
+    bool operator==(const const_iterator &other) const {
+      return index == other.index;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return index != other.index;
+    }
+  private:
+    const PieceStore<Value> *store;
+    std::size_t index;
+  };
+
+  PieceHistory(const PieceStore<Value> &store, PieceRange range) : store(store), range(range) {}
+
+  const_iterator begin() const {
+    return const_iterator(store, range.begin);
+  }
+  const_iterator end() const {
+    return const_iterator(store, range.end);
+  }
+  std::size_t size() const {
+    return range.size();
+  }
+  bool empty() const {
+    return range.empty();
+  }
+  const std::vector<Value> &operator[](std::size_t i) const {
+    return store[range.begin + i];
+  }
+  const std::vector<Value> &back() const {
+    return store[range.end - 1];
+  }
+  const PieceRange &getRange() const {
+    return range;
+  }
+
+private:
+  const PieceStore<Value> &store;
+  const PieceRange range;
+};
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <thread>
+#include <boost/program_options.hpp>
+
+#include "result_writer.hh"
+#include "signal_reader.hh"
+#include "unix_socket.hh"
+
+using namespace boost::program_options;
+
+/*!
+  @brief Print the result received from the daemon
+
+  The binary result is decoded and printed in the text format. The result in the other formats is copied as it is.
+ */
+static inline void receiveResult(int fd) {
+  std::vector<char> buffer(1 << 16);
+  BinaryResultDecoder decoder;
+  BinaryResultDecoder::Record record;
+  // The writer of each automaton
+  std::map<std::string, std::unique_ptr<ResultWriter>> writers;
+  std::string head;
+  bool isBinary = false;
+  bool isDecided = false;
+  while (true) {
+    const ssize_t size = read(fd, buffer.data(), buffer.size());
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size <= 0) {
+      break;
+    }
+    if (!isDecided) {
+      // Decide the format by the first bytes
+      head.append(buffer.data(), size);
+      if (head.size() < 8 && head.compare(0, head.size(), ResultWriter::binaryMagic, head.size()) == 0) {
+        continue;
+      }
+      isDecided = true;
+      isBinary = head.compare(0, 8, ResultWriter::binaryMagic) == 0;
+      if (isBinary) {
+        decoder.append(head.data(), head.size());
+      } else {
+        fwrite(head.data(), 1, head.size(), stdout);
+      }
+    } else if (isBinary) {
+      decoder.append(buffer.data(), size);
+    } else {
+      fwrite(buffer.data(), 1, size, stdout);
+    }
+    while (isBinary && decoder.next(record)) {
+      auto &writer = writers[record.tag];
+      if (!writer) {
+        writer = std::make_unique<ResultWriter>(stdout, ResultFormat::text, record.tag);
+      }
+      if (record.kind == 0) {
+        writer->writeMatch(record.bounds, record.weight, record.approximate);
+      } else {
+        writer->writeDegraded(record.begin, record.end);
+      }
+    }
+    for (auto &writer: writers) {
+      writer.second->flush();
+    }
+    fflush(stdout);
+  }
+  if (!isDecided) {
+    fwrite(head.data(), 1, head.size(), stdout);
+  }
+  fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+  constexpr const auto programName = "qtpm-client";
+
+  options_description visible("description of options");
+  std::string socketPath;
+  std::string signalFileName;
+  visible.add_options()
+    ("help,h", "help")
+    ("socket,s", value<std::string>(&socketPath), "the Unix domain socket of the daemon (qtpm --daemon)")
+    ("input,i", value<std::string>(&signalFileName)->default_value("stdin"), "input file of the signal")
+    ("input-format", value<std::string>()->default_value("text"), "format of the signal: text or binary")
+    ("abs,a", "absolute time mode");
+
+  command_line_parser parser(argc, argv);
+  parser.options(visible);
+  variables_map vm;
+  store(parser.run(), vm);
+  notify(vm);
+
+  if (socketPath.empty() || vm.count("help")) {
+    std::cout << programName << " [OPTIONS] -s SOCKET\n"
+              << "Send a signal to the daemon of qtpm piece by piece and print the result.\n"
+              << visible << std::endl;
+    return 0;
+  }
+  const std::string inputFormat = vm["input-format"].as<std::string>();
+  if (!isSignalFormatName(inputFormat)) {
+    std::cerr << programName << ": unknown input format: " << inputFormat << std::endl;
+    return 1;
+  }
+
+  FILE *file = signalFileName == "stdin" ? stdin : fopen(signalFileName.c_str(), "r");
+  if (file == nullptr) {
+    perror("Failed to open the input file of the signal");
+    std::cerr << signalFileName << std::endl;
+    return 1;
+  }
+  struct stat st;
+  // A signal arriving online is sent piece by piece
+  const bool isOnline = fstat(fileno(file), &st) != 0 || !S_ISREG(st.st_mode);
+
+  int fd;
+  try {
+    fd = connectUnixSocket(socketPath);
+  } catch (const std::runtime_error &e) {
+    std::cerr << programName << ": " << e.what() << std::endl;
+    return 1;
+  }
+  std::thread receiver(receiveResult, fd);
+
+  int status = 0;
+  try {
+    const auto reader = makeSignalReader(file, signalFileName, inputFormat);
+    const bool isAbsTime = reader->isAbsTime().value_or(vm.count("abs"));
+    double time;
+    std::vector<double> valuation;
+    std::string buffer;
+    // The number of the signal variables is given by the first piece
+    boost::optional<std::size_t> numOfVariables;
+    const auto send = [&] {
+      // Blocked while the daemon is behind
+      if (!writeAll(fd, buffer.data(), buffer.size())) {
+        throw std::runtime_error(socketPath + ": the daemon closed the session");
+      }
+      buffer.clear();
+    };
+    while (reader->next(time, valuation)) {
+      if (!numOfVariables) {
+        numOfVariables = valuation.size();
+        const auto header = BinarySignalReader::makeHeader(valuation.size(), isAbsTime, BinarySignalReader::ValueType::float64,
+                                                           BinarySignalReader::Layout::records);
+        buffer.append(reinterpret_cast<const char *>(&header), sizeof(header));
+      } else if (valuation.size() != *numOfVariables) {
+        throw std::runtime_error(signalFileName + ": the number of the signal variables changed");
+      }
+      buffer.append(reinterpret_cast<const char *>(&time), sizeof(double));
+      buffer.append(reinterpret_cast<const char *>(valuation.data()), valuation.size() * sizeof(double));
+      if (isOnline || buffer.size() >= (1 << 16)) {
+        send();
+      }
+    }
+    send();
+  } catch (const std::runtime_error &e) {
+    std::cerr << programName << ": " << e.what() << std::endl;
+    status = 1;
+  }
+  // The end of the signal
+  shutdown(fd, SHUT_WR);
+  receiver.join();
+  close(fd);
+
+  return status;
+}
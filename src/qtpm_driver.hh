@@ -0,0 +1,303 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "derived_signal.hh"
+#include "monitor.hh"
+#include "signal_reader.hh"
+
+using SignalVariables = uint8_t;
+using ClockVariables = uint8_t;
+using Value = double;
+using TimedAutomaton = BoostTimedAutomaton<SignalVariables, ClockVariables>;
+using MonitorPtr = std::unique_ptr<Monitor<SignalVariables, ClockVariables, Value>>;
+
+//! @brief The options on how to feed the signal
+struct QTPMOptions {
+  bool isAbsTime;
+  //! @brief The file to write the checkpoint. If it is empty, no checkpoint is written.
+  std::string checkpointFileName;
+  //! @brief The number of the pieces between two checkpoints. If it is 0, the checkpoint is written only at the end.
+  std::size_t checkpointInterval;
+  //! @brief The number of the threads
+  std::size_t jobs;
+  //! @brief The maximum number of the pieces fed at once
+  std::size_t blockSize;
+  //! @brief The signal variables derived and appended to each piece
+  std::vector<Derivation> derivations;
+  //! @brief The number of the threads of the pipeline. If it is at least 2, the signal is read in its own thread.
+  std::size_t threads = 1;
+  //! @brief If we print the statistics of the pipeline to stderr
+  bool printStats = false;
+};
+
+/*!
+  @brief Write the checkpoint of the matching
+
+  The checkpoint is first written to a temporary file and then renamed so that the previous checkpoint survives a crash during writing.
+ */
+static inline void writeCheckpoint(Monitor<SignalVariables, ClockVariables, Value> &monitor, const std::string &fileName) {
+  const std::string temporaryFileName = fileName + ".tmp";
+  std::ofstream os(temporaryFileName, std::ios::binary);
+  monitor.saveCheckpoint(os);
+  os.close();
+  if (!os || std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0) {
+    perror("Failed to write the checkpoint");
+    std::cerr << fileName << std::endl;
+    exit(1);
+  }
+}
+
+//! @brief A block of pieces of the signal stored by columns
+struct PieceBlock {
+  std::size_t size = 0;
+  std::vector<double> durations;
+  //! @brief columns[j][i] is the value of the j-th signal variable in the i-th piece
+  std::vector<std::vector<Value>> columns;
+  //! @brief The pointers to the columns given to Monitor::feedBatch
+  std::vector<const Value*> columnPointers;
+};
+
+//! @brief Read the signal by blocks of pieces
+class BlockReader {
+public:
+  BlockReader(SignalReader &reader, bool isAbsTime, double lastTime) : reader(reader), isAbsTime(isAbsTime), lastTime(lastTime) {}
+
+  /*!
+    @brief Read at most maxSize pieces to the block
+
+    A block ends before a piece with a different number of signal variables.
+    @returns false if no piece is left
+   */
+  bool read(std::size_t maxSize, PieceBlock &block) {
+    block.size = 0;
+    while (block.size < maxSize) {
+      if (!hasPending) {
+        double time;
+        if (!reader.next(time, valuation)) {
+          break;
+        }
+        pendingDuration = isAbsTime ? time - lastTime : time;
+        lastTime = time;
+        hasPending = true;
+      }
+      if (block.size == 0) {
+        block.columns.resize(valuation.size());
+      } else if (valuation.size() != block.columns.size()) {
+        break;
+      }
+      if (block.durations.size() < maxSize) {
+        block.durations.resize(maxSize);
+      }
+      block.durations[block.size] = pendingDuration;
+      for (std::size_t j = 0; j < valuation.size(); j++) {
+        if (block.columns[j].size() < maxSize) {
+          block.columns[j].resize(maxSize);
+        }
+        block.columns[j][block.size] = valuation[j];
+      }
+      block.size++;
+      hasPending = false;
+    }
+    block.columnPointers.resize(block.columns.size());
+    for (std::size_t j = 0; j < block.columns.size(); j++) {
+      block.columnPointers[j] = block.columns[j].data();
+    }
+    return block.size > 0;
+  }
+
+private:
+  SignalReader &reader;
+  const bool isAbsTime;
+  double lastTime;
+  //! @brief The piece read but not in the previous block
+  std::vector<Value> valuation;
+  double pendingDuration;
+  bool hasPending = false;
+};
+
+/*!
+  @brief The reading stage of the pipeline reading the blocks in a background thread
+
+  The blocks are handed to the matching stage through a lock-free ring buffer, and the memory of the consumed blocks is reused.
+ */
+class BlockPrefetcher {
+public:
+  /*!
+    @param [in] blockSize The maximum size of the next block given the number of the pieces read so far
+    @param [in] capacity The maximum number of the blocks read ahead
+   */
+  BlockPrefetcher(BlockReader &reader, std::function<std::size_t(std::size_t)> blockSize, std::size_t capacity) : blocks(capacity) {
+    thread = std::thread([this, &reader, blockSize] {
+        PieceBlock block;
+        std::size_t numOfPieces = 0;
+        try {
+          while (reader.read(blockSize(numOfPieces), block)) {
+            numOfPieces += block.size;
+            if (!blocks.push(block)) {
+              // The matching stage stopped
+              return;
+            }
+          }
+        } catch (...) {
+          error = std::current_exception();
+        }
+        blocks.close();
+      });
+  }
+
+  ~BlockPrefetcher() {
+    blocks.close();
+    thread.join();
+  }
+
+  /*!
+    @brief Take the next block
+
+    The error in the reading stage is rethrown here after the blocks read before it.
+    @returns false if no piece is left
+   */
+  bool read(PieceBlock &block) {
+    if (!blocks.pop(block)) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+      return false;
+    }
+    return true;
+  }
+
+  //! @pre read returned false
+  const RingBufferStats &getStats() const {
+    return blocks.getStats();
+  }
+
+private:
+  RingBuffer<PieceBlock> blocks;
+  std::exception_ptr error;
+  std::thread thread;
+};
+
+//! @brief Print the statistics of the ring buffer between two stages of the pipeline
+static inline void printStageStats(const std::string &name, const RingBufferStats &stats, std::size_t capacity) {
+  fprintf(stderr, "qtpm: %s: %zu items, mean occupancy %.2f/%zu, producer waited %.3f s, consumer waited %.3f s\n",
+          name.c_str(), stats.numOfItems, stats.meanOccupancy(), capacity, stats.producerWaitSeconds, stats.consumerWaitSeconds);
+}
+
+/*!
+  @brief Feed the signal to the monitors by blocks, printing the result after each block
+
+  With options.threads at least 2, the signal is read and parsed in its own thread ahead of the matching.
+
+  @returns The number of the pieces fed
+ */
+static inline std::size_t QTPM(std::vector<MonitorPtr> &monitors, SignalReader &fin, const QTPMOptions &options) {
+  constexpr std::size_t pipelineDepth = 8;
+  // When we resume from a checkpoint, the signal starts at the end of the checkpoint
+  BlockReader reader(fin, options.isAbsTime, monitors.front()->getAbsTime());
+  PieceBlock block;
+  std::size_t numOfPieces = 0;
+  const bool periodicCheckpoint = !options.checkpointFileName.empty() && options.checkpointInterval > 0;
+  const auto blockSize = [&options, periodicCheckpoint](std::size_t numOfPiecesRead) {
+    std::size_t maxSize = options.blockSize;
+    if (periodicCheckpoint) {
+      // A block does not go over the next checkpoint
+      maxSize = std::min(maxSize, options.checkpointInterval - numOfPiecesRead % options.checkpointInterval);
+    }
+    return maxSize;
+  };
+  std::unique_ptr<BlockPrefetcher> prefetcher;
+  if (options.threads > 1) {
+    prefetcher = std::make_unique<BlockPrefetcher>(reader, blockSize, pipelineDepth);
+  }
+  while (prefetcher ? prefetcher->read(block) : reader.read(blockSize(numOfPieces), block)) {
+    for (auto &monitor: monitors) {
+      monitor->feedBatch(block.size, block.durations.data(), block.columnPointers);
+      monitor->printResult();
+    }
+
+    numOfPieces += block.size;
+    if (periodicCheckpoint && numOfPieces % options.checkpointInterval == 0) {
+      writeCheckpoint(*monitors.front(), options.checkpointFileName);
+    }
+  }
+  if (!options.checkpointFileName.empty()) {
+    // The matching not finalized yet is kept in the checkpoint and printed after resuming
+    writeCheckpoint(*monitors.front(), options.checkpointFileName);
+  } else {
+    for (auto &monitor: monitors) {
+      monitor->flushResult();
+    }
+  }
+  if (prefetcher && options.printStats) {
+    printStageStats("reader -> matcher", prefetcher->getStats(), pipelineDepth);
+  }
+  return numOfPieces;
+}
+
+//! @brief An automaton given by -f with its semiring
+struct AutomatonSpec {
+  //! @brief The argument of -f, which is the tag of the result with multiple automata
+  std::string name;
+  std::string semiring;
+  TimedAutomaton TA;
+  std::vector<typename TimedAutomaton::vertex_descriptor> initStates;
+};
+
+//! @brief Make the monitors of the automata writing the result to out
+static inline std::vector<MonitorPtr> makeMonitors(const std::list<AutomatonSpec> &automata, const MonitorOptions &monitorOptions, FILE *out) {
+  std::vector<MonitorPtr> monitors;
+  for (const AutomatonSpec &automaton: automata) {
+    monitors.push_back(makeMonitor<SignalVariables, ClockVariables, Value>(automaton.semiring, automaton.TA, automaton.initStates, monitorOptions, out,
+                                                                           automata.size() > 1 ? automaton.name : ""));
+  }
+  return monitors;
+}
+
+/*!
+  @brief Serve a monitoring session over a connected socket
+
+  The client sends a signal in the binary format (see BinarySignalReader) and receives the result in the selected format while the pieces are matched one by one. The session has its own monitors and ends when the client shuts down its side of the connection, after which the remaining result is sent. Since the socket is blocking, a client not reading the result stops the matching of its session, which stops reading its signal in turn, i.e., the client is blocked in sending the pieces.
+
+  @param [in] fd The connected socket. It is closed at the end of the session, which also ends by any exception without terminating the daemon.
+  @param [in] name The name of the session in the error message
+ */
+static inline void serveSession(int fd, const std::string &name, const std::list<AutomatonSpec> &automata,
+                                const MonitorOptions &monitorOptions, QTPMOptions options) {
+  const std::unique_ptr<FILE, int (*)(FILE *)> in(fdopen(fd, "r"), fclose);
+  if (!in) {
+    close(fd);
+    return;
+  }
+  const std::unique_ptr<FILE, int (*)(FILE *)> out(fdopen(dup(fd), "w"), fclose);
+  if (!out) {
+    return;
+  }
+  // The result is sent as soon as the writer flushes it
+  setvbuf(out.get(), nullptr, _IONBF, 0);
+  try {
+    const std::string resultHeader = ResultWriter::header(monitorOptions.resultFormat);
+    fwrite(resultHeader.data(), 1, resultHeader.size(), out.get());
+    auto monitors = makeMonitors(automata, monitorOptions, out.get());
+    std::unique_ptr<SignalReader> reader = makeSignalReader(in.get(), name, "binary");
+    options.isAbsTime = reader->isAbsTime().value_or(options.isAbsTime);
+    if (!options.derivations.empty()) {
+      reader = std::make_unique<DerivedSignalReader>(std::move(reader), options.derivations, options.isAbsTime);
+    }
+    QTPM(monitors, *reader, options);
+  } catch (const std::exception &e) {
+    // Any failure, e.g., std::bad_alloc by a broken signal, ends only this session and not the daemon
+    std::cerr << "qtpm: " << e.what() << std::endl;
+  } catch (...) {
+    std::cerr << "qtpm: " << name << ": unknown error" << std::endl;
+  }
+}
@@ -1,9 +1,16 @@
 #pragma once
 #include <vector>
 #include <queue>
+#include <chrono>
+#include <functional>
+#include <algorithm>
 
 #include "bellman_ford.hh"
+#include "binary_io.hh"
 #include "zone_graph.hh"
+#include "timed_automaton_analysis.hh"
+#include "robustness.hh"
+#include "label_robustness.hh"
 
 /*!
   @brief A class to execute quantitative timed pattern matching
@@ -43,6 +50,40 @@ class QuantitativeTimedPatternMatching
 {
 public:
   using ResultMatrix = std::array<Bounds, 6>;
+  /*!
+    @brief The callback receiving the finalized matching and its weight
+
+    The last argument shows if the matching is possibly over-approximated (see @ref setMaxConfigurations).
+  */
+  using ResultSink = std::function<void(const ResultMatrix &, const Weight &, bool)>;
+  /*!
+    @brief The levels of the degraded mode from the cheapest fallback to the last resort (see @ref setLatencyBudget)
+
+    Each piece over the latency budget raises the level by one, and each piece within half of the budget lowers it by one.
+  */
+  enum class DegradedLevel {
+    //! @brief The exact mode
+    exact,
+    //! @brief The zones at the same state are not merged. The result is still exact.
+    skipMerge,
+    //! @brief In addition, the matching starts only at every @ref sparseStartInterval -th piece
+    sparseStarts,
+    //! @brief In addition, no matching starts
+    noStarts
+  };
+  //! @brief The interval of the pieces where the matching starts at the level DegradedLevel::sparseStarts
+  static constexpr std::size_t sparseStartInterval = 4;
+  //! @brief The time spent in each phase of the latest piece in seconds
+  struct PhaseTimes {
+    double zoneConstruction = 0;
+    double shortestPath = 0;
+    double configuration = 0;
+    double result = 0;
+
+    double total() const {
+      return zoneConstruction + shortestPath + configuration + result;
+    }
+  };
 private:
   //types
 
@@ -52,21 +93,36 @@ private:
   using ZoneGraph = BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>;
   using ZGState = typename ZoneGraph::vertex_descriptor;
 
-  using ConfTuple_t = std::tuple<TAState, bool, std::vector<std::vector<Value>>, Weight>;
+  using ConfTuple_t = std::tuple<TAState, bool, PieceRange, Weight>;
 
   // constants
 
+  static constexpr const char checkpointMagic[8] = {'Q', 'T', 'P', 'M', 'C', 'K', 'P', 'T'};
+  //! @brief The version of the checkpoint. Version 3 numbers the TA states after the preprocessing (see preprocessBoostTA). Version 4 writes the pieces shared by the configurations only once. Version 5 writes the fingerprint of the TA.
+  static constexpr uint32_t checkpointVersion = 5;
   const std::size_t numOfClockVariables;
   const std::size_t dwellTimeClock;
   DBM initialZone;
   const TimedAutomaton TA;
   const std::vector<TAState> initStates;
-  const std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost;
+  const std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost;
+  //! @brief The maximum duration from the beginning of the matching at each state such that an accepting state is still reachable (see @ref maxFeasibleDurations)
+  const std::vector<double> maxDurations;
+  //! @brief The activeness of each clock variable at each state (see @ref activeClockVariables)
+  const std::vector<std::vector<bool>> activeClocks;
+  /*!
+    @brief If we discard the runs as soon as their weight becomes zero
+
+    Since zero is absorbing for the multiplication, such a run never contributes to the result. We skip the initial states whose label is zero for the current piece, the transitions of weight zero in the zone construction, and the configurations of weight zero.
+  */
+  const bool ignoreZero;
 
   // variables
 
   //! @brief the current configuration
   Conf_t configuration = {};
+  //! @brief The pieces referred to by the histories of the configurations
+  PieceStore<Value> pieces;
   //! @brief the current absolute time
   double absTime = 0;
   /*! 
@@ -74,73 +130,365 @@ private:
     @todo consider better data structure (something like segment tree)
   */
   boost::unordered_map<ResultMatrix, Weight> result = {};
+  /*!
+    @brief The sink of the finalized matching
+    @note If this is empty, the matching is kept in this->result until the caller clears it.
+  */
+  ResultSink sink;
+  /*!
+    @brief The earliest start time of the matching that the current configurations can still produce
 
-public:
+    Any matching whose start time is strictly before the watermark is never updated later.
+  */
+  double watermark = 0;
+  //! @brief If we remove the configurations dominated by another configuration
+  bool pruneDominated = semiring_traits<Weight>::is_idempotent;
+  //! @brief The minimum weight of the matching we are interested in
+  boost::optional<Weight> threshold;
+  //! @brief If we start new matching from the pieces fed later
+  bool startMatching = true;
+  //! @brief The maximum number of the configurations. If it is 0, the number is not limited.
+  std::size_t maxConfigurations = 0;
+  //! @brief The maximum estimated memory usage of the configurations in bytes. If it is 0, the memory usage is not limited.
+  std::size_t memoryBudget = 0;
+  //! @brief The absolute time of the latest over-approximation of the configurations
+  double lastApproximationTime = -std::numeric_limits<double>::infinity();
+  //! @brief The number of the pieces where the configurations are over-approximated
+  std::size_t numOfApproximations = 0;
+  //! @brief The number of the configurations removed by the over-approximation
+  std::size_t numOfMergedConfigurations = 0;
+  //! @brief The maximum number of the configurations after a piece so far
+  std::size_t peakNumOfConfigurations = 0;
+  //! @brief The maximum processing time of a piece in seconds. If it is 0, the processing time is not limited.
+  double latencyBudget = 0;
+  //! @brief If we measure the phase times without the latency budget
+  bool measurePhaseTimes = false;
+  //! @brief The level of the degraded mode (see @ref setLatencyBudget)
+  DegradedLevel degradedLevel = DegradedLevel::exact;
+  //! @brief The number of the pieces since the level became DegradedLevel::sparseStarts
+  std::size_t numOfSparsePieces = 0;
+  //! @brief The absolute time when the current degraded interval, where the starts are limited, began
+  double degradedSince = 0;
+  //! @brief The degraded intervals not taken by the caller yet
+  std::vector<std::pair<double, double>> degradedIntervals;
+  PhaseTimes phaseTimes;
 
-  QuantitativeTimedPatternMatching(const TimedAutomaton &TA,
-                                   const std::vector<TAState> &initStates,
-                                   const std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> &cost,
-                                   const bool ignoreZero = false) : numOfClockVariables(boost::get_property(TA, boost::graph_num_of_vars)), dwellTimeClock(numOfClockVariables + 2), TA(TA), initStates(initStates), cost(cost) {
-    DBM z = DBM::zero(numOfClockVariables + 1 + 2);
-    // release Z(N+2)
-    z.M = Bounds(std::numeric_limits<double>::infinity(), false);
-    z.release(dwellTimeClock - 1);
-    z.tightenWithoutClose(-1, dwellTimeClock - 1, {0, true});
-    z.canonize();
-    initialZone = std::move(z);
+  // buffers reused over the pieces
+
+  std::unordered_map<ZGState, Weight> initStatesZG;
+  std::unordered_map<ZGState, Weight> distance;
+  boost::unordered_map<ConfTuple_t, std::list<DBM>> confMap;
+  std::vector<Value> batchValuation;
+  /*!
+    @brief The robustness of the labels for the block given to @ref feedBatch
+
+    It is used only when it is enabled by @ref useLabelTable.
+  */
+  boost::optional<LabelRobustnessTable<Weight, Value, SignalVariables>> labelTable;
+  //! @brief The index in @ref pieces of the first piece of the block given to @ref feedBatch. It is none in @ref feed.
+  boost::optional<std::size_t> batchBegin;
+
+  /*!
+    @brief The same as @ref multipleSpaceRobustness for the label of q using @ref labelTable
+
+    The pieces in the current block are looked up in the table, and only the older ones are evaluated.
+  */
+  Weight tableCost(const TAState q, const PieceHistory<Value> &history) const {
+    const PieceRange &range = history.getRange();
+    const std::size_t label = labelTable->labelOf(q);
+    Weight weight = Weight::one();
+    for (std::size_t i = range.begin; i < range.end; i++) {
+      weight *= i >= *batchBegin ? labelTable->at(label, i - *batchBegin) : singleSpaceRobustness<Weight>(TA[q].label, pieces[i]);
+    }
+    return weight;
+  }
+
+  //! @brief The index of the oldest piece referred to by the configurations. The older pieces are no longer used.
+  std::size_t getOldestPiece() const {
+    std::size_t oldest = pieces.getEnd();
+    for (const auto &c: configuration) {
+      if (!c.first.history.empty()) {
+        oldest = std::min(oldest, c.first.history.begin);
+      }
+    }
+    return oldest;
+  }
+
+  //! @brief Check if the weight can no longer reach the threshold
+  bool belowThreshold(const Weight &weight) const {
+    return threshold && weight + *threshold != weight;
+  }
+
+  //! @brief Update the watermark with the current configurations and send the finalized matching to the sink
+  void emitFinalizedResult() {
+    watermark = absTime;
+    for (const auto &c: configuration) {
+      // The upper bound of the duration from the actual start
+      watermark = std::min(watermark, absTime - c.first.zone.value(numOfClockVariables + 1, 0).first);
+    }
+    // The emission is deferred in the degraded mode
+    if (!sink || degradedLevel != DegradedLevel::exact) {
+      return;
+    }
+    for (auto it = result.begin(); it != result.end();) {
+      const Bounds &upperBeginning = it->first[1];
+      if (upperBeginning.first < watermark || (upperBeginning.first == watermark && !upperBeginning.second)) {
+        sink(it->first, it->second, isApproximate(it->first));
+        it = result.erase(it);
+      } else {
+        it++;
+      }
+    }
   }
 
   /*!
-   * @brief feed one valuation with dwell time
-   *
-   * In this function, a piece of the entire piecewise constant function is fed and the matching ending in this piece is added to this->result.
-   * See @ref outline-qtpm for the outline of the algorithm.
-   *
-   * @param [in] valuation The new signal valuation
-   * @param [in] duration The duration of the given signal valuation
-   * @note It is not a problem to give the same valuation consecutively.
+    @brief Remove the configurations dominated by another configuration
+
+    A configuration \f$(q, Z, h, w)\f$ is dominated by \f$(q, Z', h, w')\f$ if \f$Z \subseteq Z'\f$ and \f$w + w' = w'\f$. Any run from the former is also a run from the latter with the same continuation weight \f$c\f$. Since the semiring is idempotent, \f$w c + w' c = w' c\f$ and the former never changes the weight of any matching.
+
+    @pre The semiring is idempotent and the zones are canonical.
+  */
+  void pruneDominatedConfigurations() {
+    boost::unordered_map<std::tuple<TAState, bool, PieceRange>, std::vector<std::size_t>> sameStates;
+    for (std::size_t i = 0; i < configuration.size(); i++) {
+      const auto &state = configuration[i].first;
+      sameStates[std::make_tuple(state.vertex, state.jumpable, state.history)].push_back(i);
+    }
+
+    std::vector<bool> dominated(configuration.size(), false);
+    bool removed = false;
+    for (const auto &indices: sameStates) {
+      if (indices.second.size() <= 1) {
+        continue;
+      }
+      for (const std::size_t i: indices.second) {
+        if (dominated[i]) {
+          continue;
+        }
+        const auto &dominating = configuration[i];
+        for (const std::size_t j: indices.second) {
+          if (i == j || dominated[j]) {
+            continue;
+          }
+          const auto &c = configuration[j];
+          if (c.second + dominating.second == dominating.second && c.first.zone <= dominating.first.zone) {
+            dominated[j] = true;
+            removed = true;
+          }
+        }
+      }
+    }
+    if (!removed) {
+      return;
+    }
+
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < configuration.size(); i++) {
+      if (!dominated[i]) {
+        if (next != i) {
+          configuration[next] = std::move(configuration[i]);
+        }
+        next++;
+      }
+    }
+    configuration.erase(configuration.begin() + next, configuration.end());
+  }
+
+  //! @brief Check if the configurations exceed the limit of the number or the memory usage
+  bool exceedsBudget() const {
+    return (maxConfigurations > 0 && configuration.size() > maxConfigurations) ||
+      (memoryBudget > 0 && getMemoryUsage() > memoryBudget);
+  }
+
+  /*!
+    @brief Over-approximate the configurations to reduce their number
+
+    The configurations with the same TA state and the same signal valuations after the latest transition are replaced with one configuration whose zone is the convex hull of their zones and whose weight is the sum of their weights. The resulting matching may contain points that are not matching and the weights may be over-approximated in the natural order of the semiring.
    */
-  void feed(const std::vector<Value> &valuation, const double duration) {
+  void approximateConfigurations(const double time) {
+    boost::unordered_map<std::tuple<TAState, bool, PieceRange>, std::size_t> representatives;
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < configuration.size(); i++) {
+      auto &state = configuration[i].first;
+      auto it = representatives.find(std::make_tuple(state.vertex, state.jumpable, state.history));
+      if (it == representatives.end()) {
+        representatives.emplace(std::make_tuple(state.vertex, state.jumpable, state.history), next);
+        if (next != i) {
+          configuration[next] = std::move(configuration[i]);
+        }
+        next++;
+      } else {
+        auto &representative = configuration[it->second];
+        representative.first.zone.convexUnion(state.zone, representative.first.zone);
+        representative.second += configuration[i].second;
+      }
+    }
+    if (next == configuration.size()) {
+      return;
+    }
+    numOfApproximations++;
+    numOfMergedConfigurations += configuration.size() - next;
+    lastApproximationTime = time;
+    configuration.erase(configuration.begin() + next, configuration.end());
+  }
+
+  /*!
+    @brief feed one piece without giving the finalized matching to the sink
+
+    The processing time is measured to change the level of the degraded mode.
+    @sa feed
+  */
+  void feedPiece(const std::vector<Value> &valuation, const double duration) {
+    phaseTimes = PhaseTimes{};
+    processPiece(valuation, duration);
+    peakNumOfConfigurations = std::max(peakNumOfConfigurations, configuration.size());
+    if (latencyBudget <= 0) {
+      return;
+    }
+    const double elapsed = phaseTimes.total();
+    // We use a hysteresis not to change the level too frequently
+    if (elapsed > latencyBudget && degradedLevel != DegradedLevel::noStarts) {
+      setDegradedLevel(DegradedLevel(int(degradedLevel) + 1));
+    } else if (elapsed < latencyBudget / 2 && degradedLevel != DegradedLevel::exact) {
+      setDegradedLevel(DegradedLevel(int(degradedLevel) - 1));
+    }
+  }
+
+  //! @brief Change the level of the degraded mode, recording the degraded interval where the starts are limited
+  void setDegradedLevel(DegradedLevel level) {
+    const bool wasLimited = degradedLevel >= DegradedLevel::sparseStarts;
+    const bool isLimited = level >= DegradedLevel::sparseStarts;
+    if (!wasLimited && isLimited) {
+      degradedSince = absTime;
+      numOfSparsePieces = 0;
+    } else if (wasLimited && !isLimited) {
+      degradedIntervals.emplace_back(degradedSince, absTime);
+    }
+    degradedLevel = level;
+  }
+
+  //! @brief If the matching starts from the current piece in the degraded mode
+  bool startsInDegradedMode() {
+    switch (degradedLevel) {
+    case DegradedLevel::exact:
+    case DegradedLevel::skipMerge:
+      return true;
+    case DegradedLevel::sparseStarts:
+      return numOfSparsePieces++ % sparseStartInterval == 0;
+    case DegradedLevel::noStarts:
+      return false;
+    }
+    return true;
+  }
+
+  /*!
+    @brief The timer of the phases of a piece
+
+    The clock is read only if the latency budget is set or the phase times are requested by @ref setMeasurePhaseTimes.
+  */
+  class PhaseTimer {
+  public:
+    explicit PhaseTimer(bool enabled) : enabled(enabled) {
+      if (enabled) {
+        phaseBegin = std::chrono::steady_clock::now();
+      }
+    }
+    //! @brief Record the time of the current phase and begin the next one
+    void endPhase(double &seconds) {
+      if (enabled) {
+        const auto now = std::chrono::steady_clock::now();
+        seconds = std::chrono::duration<double>(now - phaseBegin).count();
+        phaseBegin = now;
+      }
+    }
+  private:
+    const bool enabled;
+    std::chrono::steady_clock::time_point phaseBegin;
+  };
+
+  /*!
+    @brief The body of @ref feedPiece
+
+    In the degraded mode, the zones are not merged and the matching may not start from this piece depending on the level.
+  */
+  void processPiece(const std::vector<Value> &valuation, const double duration) {
+    PhaseTimer timer(latencyBudget > 0 || measurePhaseTimes);
+
+    // Drop the configurations whose duration already exceeds the bound before copying their zones
+    configuration.erase(std::remove_if(configuration.begin(), configuration.end(), [&](const auto &c) {
+          // The lower bound of the duration from the beginning of the matching
+          return -c.first.zone.value(0, numOfClockVariables + 1).first > maxDurations[c.first.vertex];
+        }), configuration.end());
+    pieces.discardBefore(getOldestPiece());
+    const std::size_t currentPiece = pieces.push(valuation);
 
     for (auto &c: configuration) {
       // reset Z(N+2)
       c.first.zone.reset(dwellTimeClock - 1);
       // Check if the transition can fire at the beginning of the new piece of signal
       if (c.first.jumpable) {
-        c.first.valuations.push_back(valuation);
+        c.first.history = c.first.history.extendedTo(currentPiece);
         c.first.zone.elapse();
       }
     }
 
     // Add new configurations from initial states for the matching beginning from this piece of signal
-    configuration.reserve(configuration.size() + initStates.size());
-    for(const auto &q0: initStates) {
-      configuration.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q0, false, initialZone, std::vector<std::vector<Value>>{}}, Weight::one());
+    if (startsInDegradedMode() && startMatching) {
+      configuration.reserve(configuration.size() + initStates.size());
+      const PieceHistory<Value> spawnHistory(pieces, PieceRange{}.extendedTo(currentPiece));
+      for(const auto &q0: initStates) {
+        // Any run from q0 stays in q0 during the current piece and its weight has the label of q0 for this piece as a factor
+        if (ignoreZero && cost(TA[q0].label, spawnHistory) == Weight::zero()) {
+          continue;
+        }
+        DBM zone = initialZone;
+        releaseInactiveClockVariables(zone, activeClocks[q0]);
+        configuration.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q0, false, std::move(zone), PieceRange{}}, Weight::one());
+      }
+    }
+
+    if (configuration.empty()) {
+      // No matching to extend in this piece
+      absTime += duration;
+      return;
     }
 
     // Conduct zone construction for time bound `duration` for the current signal valuation
     ZoneGraph ZG;
-    std::unordered_map<ZGState, Weight> initStatesZG;
-    zoneConstructionWithT(TA, configuration, cost, valuation, duration, ZG, initStatesZG);
+    std::function<bool(const Weight &)> prune = nullptr;
+    if (threshold || ignoreZero) {
+      prune = [this] (const Weight &weight) {
+        return (ignoreZero && weight == Weight::zero()) || belowThreshold(weight);
+      };
+    }
+    std::function<Weight(TAState, const PieceHistory<Value> &)> stateCost = nullptr;
+    if (labelTable && batchBegin) {
+      stateCost = [this] (TAState q, const PieceHistory<Value> &history) {
+        return tableCost(q, history);
+      };
+    }
+    zoneConstructionWithT(TA, configuration, cost, pieces, duration, ZG, initStatesZG, prune, activeClocks, stateCost);
 #ifdef DEBUG
     assert(std::none_of(initStatesZG.begin(), initStatesZG.end(), [&](auto p) {
           return TA[ZG[p.first].vertex].isMatch;
         }));
 #endif
+    timer.endPhase(phaseTimes.zoneConstruction);
 
     // Compute the accumulated weights, i.e., the quantitative semantics using the generalized Bellman-Ford algorithm
-    std::unordered_map<ZGState, Weight> distance;
+    distance.clear();
     bellman_ford<std::queue<ZGState>>(ZG, initStatesZG, distance);
     // This does not work when VerticesList is ListS. I do not know why.
     // write_graphviz(std::cerr, ZG, makeZoneGraphLabelWriter(ZG, TA, distance),make_weight_label_writer(ZG));
+    timer.endPhase(phaseTimes.shortestPath);
     configuration.clear();
 
-    boost::unordered_map<ConfTuple_t, std::list<DBM>> confMap;
+    confMap.clear();
 
     // Construct the configuration just after the current piece
     for (auto w: distance) {
-      // Ignore if the weight is already "zero"
-      if (w.second == Weight::zero()) {
+      // Ignore if the weight is already "zero" or it can no longer reach the threshold
+      if (w.second == Weight::zero() || belowThreshold(w.second)) {
         continue;
       }
       // It is assumed that we do not have to use the configuration once we reach the accepting state.
@@ -151,18 +499,20 @@ public:
         z.tightenWithoutClose(-1, dwellTimeClock - 1, Bounds{-duration, true});
         z.tightenWithoutClose(dwellTimeClock - 1, -1, Bounds{duration, true});
         if (z.isSatisfiable()) {
-          auto it = confMap.find(std::make_tuple(ZG[w.first].vertex, ZG[w.first].jumpable, ZG[w.first].valuations, w.second));
+          auto it = confMap.find(std::make_tuple(ZG[w.first].vertex, ZG[w.first].jumpable, ZG[w.first].history, w.second));
           if (it != confMap.end()) {
-            // Try to merge this zone to another zone at the same state
-            for (DBM &zz: it->second) {
-              if (zz.merge(z)) {
-                goto next;
+            // Try to merge this zone to another zone at the same state. The merging is skipped in the degraded mode.
+            if (degradedLevel == DegradedLevel::exact) {
+              for (DBM &zz: it->second) {
+                if (zz.merge(z)) {
+                  goto next;
+                }
               }
             }
             // If the merging fails, we add this configuration
             it->second.push_back(std::move(z));
           } else {
-            confMap[std::make_tuple(ZG[w.first].vertex, ZG[w.first].jumpable, ZG[w.first].valuations ,w.second)].push_back(std::move(z));
+            confMap[std::make_tuple(ZG[w.first].vertex, ZG[w.first].jumpable, ZG[w.first].history, w.second)].push_back(std::move(z));
           }
         }
       }
@@ -170,10 +520,8 @@ public:
     }
 
     for (auto &c: confMap) {
-      if (c.second.size() == 1) {
-        configuration.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{std::get<0>(c.first), std::get<1>(c.first), c.second.front(), std::get<2>(c.first)}, std::get<3>(c.first));
-
-      } else {
+      // The pairwise merging is skipped in the degraded mode
+      if (c.second.size() > 1 && degradedLevel == DegradedLevel::exact) {
         bool removed = true;
         while (removed) {
           removed = false;
@@ -190,13 +538,21 @@ public:
             }
           }
         }
-        for (auto &z: c.second) {
-          // for the current check
-          configuration.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{std::get<0>(c.first), std::get<1>(c.first), std::move(z), std::get<2>(c.first)}, std::get<3>(c.first));
-        }
+      }
+      for (auto &z: c.second) {
+        // for the current check
+        configuration.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{std::get<0>(c.first), std::get<1>(c.first), std::move(z), std::get<2>(c.first)}, std::get<3>(c.first));
       }
     }
 
+    if (pruneDominated) {
+      pruneDominatedConfigurations();
+    }
+    if (exceedsBudget()) {
+      approximateConfigurations(absTime + duration);
+    }
+    timer.endPhase(phaseTimes.configuration);
+
     // Put the resulting matching to this->result
     for (auto &w: distance) {
       if (w.second == Weight::zero()) {
@@ -219,10 +575,430 @@ public:
       }
     }
 
+    initStatesZG.clear();
+    distance.clear();
+    confMap.clear();
+    timer.endPhase(phaseTimes.result);
+
     // Update absTime to the end of the current piece
     absTime += duration;
   }
 
+public:
+
+  QuantitativeTimedPatternMatching(const TimedAutomaton &TA,
+                                   const std::vector<TAState> &initStates,
+                                   const std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> &cost,
+                                   const bool ignoreZero = false) : numOfClockVariables(boost::get_property(TA, boost::graph_num_of_vars)), dwellTimeClock(numOfClockVariables + 2), TA(TA), initStates(initStates), cost(cost), maxDurations(maxFeasibleDurations(TA)), activeClocks(activeClockVariables(TA)), ignoreZero(ignoreZero) {
+    DBM z = DBM::zero(numOfClockVariables + 1 + 2);
+    // release Z(N+2)
+    z.M = Bounds(std::numeric_limits<double>::infinity(), false);
+    z.release(dwellTimeClock - 1);
+    z.tightenWithoutClose(-1, dwellTimeClock - 1, {0, true});
+    z.canonize();
+    initialZone = std::move(z);
+  }
+
+  /*!
+   * @brief feed one valuation with dwell time
+   *
+   * In this function, a piece of the entire piecewise constant function is fed and the matching ending in this piece is added to this->result.
+   * See @ref outline-qtpm for the outline of the algorithm.
+   *
+   * @param [in] valuation The new signal valuation
+   * @param [in] duration The duration of the given signal valuation
+   * @note It is not a problem to give the same valuation consecutively.
+   */
+  void feed(const std::vector<Value> &valuation, const double duration) {
+    feedPiece(valuation, duration);
+    emitFinalizedResult();
+  }
+
+  /*!
+   * @brief feed a block of pieces at once
+   *
+   * This is equivalent to calling @ref feed for each piece, but the finalized matching is given to the sink only once at the end of the block and the buffer for the valuation is reused. The signal values are given by columns so that a caller with columnar data does not have to make a vector for each piece. When @ref useLabelTable is enabled, the labels are evaluated over the whole block first.
+   *
+   * @param [in] size The number of the pieces
+   * @param [in] durations The duration of each piece
+   * @param [in] columns columns[j][i] is the value of the j-th signal variable in the i-th piece
+   */
+  void feedBatch(const std::size_t size, const double *durations, const std::vector<const Value*> &columns) {
+    batchValuation.resize(columns.size());
+    if (labelTable) {
+      labelTable->evaluate(size, columns);
+      batchBegin = pieces.getEnd();
+    }
+    for (std::size_t i = 0; i < size; i++) {
+      if (i + 1 < size) {
+        // The next valuation is used right after the zone graph of this piece
+        for (const Value *column: columns) {
+          __builtin_prefetch(column + i + 1);
+        }
+      }
+      for (std::size_t j = 0; j < columns.size(); j++) {
+        batchValuation[j] = columns[j][i];
+      }
+      feedPiece(batchValuation, durations[i]);
+    }
+    batchBegin = boost::none;
+    emitFinalizedResult();
+  }
+
+  /*!
+   * @brief Set the sink of the finalized matching
+   *
+   * When the sink is set, the matching behind the watermark is given to the sink at the end of each @ref feed and removed from this->result. Since such a matching is never updated later, the memory usage for the result is bounded by the matching not finalized yet.
+   */
+  void setResultSink(ResultSink newSink) {
+    sink = std::move(newSink);
+  }
+
+  //! @brief Give all the remaining matching to the sink, e.g., at the end of the signal
+  void flushResult() {
+    if (degradedLevel >= DegradedLevel::sparseStarts) {
+      // Report the degraded interval so far
+      degradedIntervals.emplace_back(degradedSince, absTime);
+      degradedSince = absTime;
+    }
+    if (!sink) {
+      return;
+    }
+    for (const auto &r: result) {
+      sink(r.first, r.second, isApproximate(r.first));
+    }
+    result.clear();
+  }
+
+  /*!
+   * @brief Evaluate the labels over each block given to @ref feedBatch at once (see @ref LabelRobustnessTable)
+   *
+   * It is disabled by default. It may be enabled only if the cost is @ref multipleSpaceRobustness because the table is used in place of the cost for the pieces in the block.
+   */
+  void useLabelTable(bool enable) {
+    if (!enable) {
+      labelTable = boost::none;
+    } else if (!labelTable) {
+      labelTable.emplace(TA);
+    }
+  }
+
+  /*!
+   * @brief Enable or disable the pruning of the dominated configurations
+   *
+   * The pruning is enabled by default if the semiring is idempotent (see @ref semiring_traits). It cannot be enabled for the other semirings.
+   */
+  void setPruneDominated(bool enable) {
+    pruneDominated = enable && semiring_traits<Weight>::is_idempotent;
+  }
+
+  /*!
+   * @brief Limit the number of the configurations
+   *
+   * When the number of the configurations after a piece exceeds the limit, the configurations are over-approximated (see @ref getNumOfApproximations). The matching that may be affected is flagged by @ref isApproximate. The limit is not strict: the configurations with different signal valuations after their latest transition are not merged.
+   *
+   * @param [in] limit The maximum number of the configurations. If it is 0, the number is not limited.
+   */
+  void setMaxConfigurations(std::size_t limit) {
+    maxConfigurations = limit;
+  }
+
+  /*!
+   * @brief Limit the estimated memory usage of the configurations
+   *
+   * This is the same as @ref setMaxConfigurations but the limit is on @ref getMemoryUsage.
+   *
+   * @param [in] bytes The maximum memory usage in bytes. If it is 0, the memory usage is not limited.
+   */
+  void setMemoryBudget(std::size_t bytes) {
+    memoryBudget = bytes;
+  }
+
+  //! @brief The estimated memory usage of the current configurations in bytes
+  std::size_t getMemoryUsage() const {
+    std::size_t usage = configuration.capacity() * sizeof(typename Conf_t::value_type) + pieces.getMemoryUsage();
+    for (const auto &c: configuration) {
+      usage += c.first.zone.value.size() * sizeof(Bounds);
+    }
+    return usage;
+  }
+
+  /*!
+   * @brief Check if the matching is possibly over-approximated
+   *
+   * A matching is possibly over-approximated if it may begin before the latest over-approximation of the configurations.
+   */
+  bool isApproximate(const ResultMatrix &mat) const {
+    return -mat[0].first <= lastApproximationTime;
+  }
+
+  //! @brief The number of the pieces after which the configurations are over-approximated
+  std::size_t getNumOfApproximations() const {
+    return numOfApproximations;
+  }
+
+  //! @brief The number of the configurations removed by the over-approximation in total
+  std::size_t getNumOfMergedConfigurations() const {
+    return numOfMergedConfigurations;
+  }
+
+  /*!
+   * @brief Limit the processing time of each piece
+   *
+   * When the processing of a piece takes longer than the budget, the later pieces are processed in the degraded mode. The fallback is graded so that the matching is not lost at the first slow piece: each piece over the budget raises the level of the degraded mode by one, and each piece taking less than half of the budget lowers it by one (see DegradedLevel).
+   * 1. The zones at the same state are not merged, which skips the pairwise merge attempts. The result is still exact.
+   * 2. In addition, a new matching starts only at every @ref sparseStartInterval -th piece.
+   * 3. In addition, no new matching starts, so that the configurations decrease as the ongoing matching finishes.
+   *
+   * In the degraded mode, the finalized matching is not given to the sink until we return to the exact mode. The matching beginning in a degraded interval, where the level is 2 or 3, may be missing. The degraded intervals are reported by @ref getDegradedIntervalsRef.
+   *
+   * @param [in] seconds The budget in seconds. If it is 0, the processing time is not limited.
+   */
+  void setLatencyBudget(double seconds) {
+    latencyBudget = seconds;
+  }
+
+  //! @brief If the later pieces are processed in the degraded mode
+  bool isDegraded() const {
+    return degradedLevel != DegradedLevel::exact;
+  }
+
+  //! @brief The level of the degraded mode of the later pieces
+  DegradedLevel getDegradedLevel() const {
+    return degradedLevel;
+  }
+
+  /*!
+   * @brief Measure the phase times even if the latency budget is not set
+   *
+   * The phase times are measured only when they are needed because reading the clock for every phase of every piece is not free.
+   */
+  void setMeasurePhaseTimes(bool enable) {
+    measurePhaseTimes = enable;
+  }
+
+  //! @brief The time spent in each phase of the latest piece. They are 0 unless the latency budget is set or @ref setMeasurePhaseTimes is enabled.
+  const PhaseTimes &getPhaseTimes() const {
+    return phaseTimes;
+  }
+
+  /*!
+   * @brief The degraded intervals [begin, end) of the absolute time finished so far
+   *
+   * Similarly to the result, the caller is expected to clear it after taking them. The degraded interval not finished yet is added by @ref flushResult.
+   */
+  std::vector<std::pair<double, double>> &getDegradedIntervalsRef() {
+    return degradedIntervals;
+  }
+
+  /*!
+   * @brief Set the minimum weight of the matching we are interested in
+   *
+   * The configurations and the transitions whose weight is not greater than or equal to the threshold, i.e., \f$w + \mathit{threshold} \neq w\f$, are discarded in the zone construction and in the construction of the next configurations. Since the weight never improves for a monotone semiring, the matching whose weight reaches the threshold is not affected.
+   *
+   * @pre semiring_traits<Weight>::is_monotone
+   */
+  void setThreshold(const Weight &newThreshold) {
+#ifdef DEBUG
+    assert(semiring_traits<Weight>::is_monotone);
+#endif
+    threshold = newThreshold;
+  }
+
+  /*!
+   * @brief Enable or disable starting new matching from the pieces fed later
+   *
+   * When it is disabled, only the matching already started is extended. This is used to process a chunk of the signal independently of the other chunks.
+   */
+  void setStartMatching(bool enable) {
+    startMatching = enable;
+  }
+
+  /*!
+   * @brief Set the absolute time at the beginning of the next piece
+   *
+   * @pre No configuration is alive, e.g., no piece is fed yet.
+   */
+  void startAt(double time) {
+#ifdef DEBUG
+    assert(configuration.empty());
+#endif
+    absTime = time;
+    watermark = time;
+  }
+
+  /*!
+   * @brief Write the state of the matching to a binary checkpoint
+   *
+   * The checkpoint consists of the current configurations, the current absolute time, and the matching not taken by the caller yet. Its size is proportional to the number of the current configurations and does not depend on the length of the signal fed so far.
+   *
+   * The format is as follows, where each number is in the native byte order.
+   *
+   * 1. The magic number "QTPMCKPT" and the version (uint32_t)
+   * 2. The number of the clock variables, the number of the TA states, and the fingerprint of the TA after the preprocessing (see @ref automatonFingerprint) (uint64_t), which are used to check that the checkpoint is for the same TA
+   * 3. The absolute time, the watermark, and the time of the latest over-approximation (double)
+   * 4. The pieces referred to by the configurations: the number of them (uint64_t) followed by, for each of them, the number of the signal variables (uint64_t) and the valuation
+   * 5. The configurations: the number of them (uint64_t) followed by, for each of them, the TA state (uint64_t), the jumpable flag (uint8_t), the zone, the pieces observed after the latest transition as the index of the first one in the pieces above and the number of them (uint64_t), and the weight
+   * 6. The result: the number of the matching (uint64_t) followed by, for each of them, the six bounds and the weight
+   */
+  void saveCheckpoint(std::ostream &os) const {
+    os.write(checkpointMagic, sizeof(checkpointMagic));
+    writeBinary(os, checkpointVersion);
+    writeBinary(os, uint64_t(numOfClockVariables));
+    writeBinary(os, uint64_t(boost::num_vertices(TA)));
+    writeBinary(os, automatonFingerprint(TA));
+    writeBinary(os, absTime);
+    writeBinary(os, watermark);
+    writeBinary(os, lastApproximationTime);
+
+    const std::size_t oldest = getOldestPiece();
+    writeBinary(os, uint64_t(pieces.getEnd() - oldest));
+    for (std::size_t i = oldest; i < pieces.getEnd(); i++) {
+      writeBinary(os, uint64_t(pieces[i].size()));
+      os.write(reinterpret_cast<const char*>(pieces[i].data()), sizeof(Value) * pieces[i].size());
+    }
+
+    writeBinary(os, uint64_t(configuration.size()));
+    for (const auto &c: configuration) {
+      writeBinary(os, uint64_t(c.first.vertex));
+      writeBinary(os, uint8_t(c.first.jumpable));
+      writeBinary(os, c.first.zone);
+      writeBinary(os, uint64_t(c.first.history.empty() ? 0 : c.first.history.begin - oldest));
+      writeBinary(os, uint64_t(c.first.history.size()));
+      writeBinary(os, c.second.data);
+    }
+
+    writeBinary(os, uint64_t(result.size()));
+    for (const auto &r: result) {
+      for (const Bounds &b: r.first) {
+        writeBinary(os, b);
+      }
+      writeBinary(os, r.second.data);
+    }
+  }
+
+  /*!
+   * @brief Restore the state of the matching from a checkpoint written by @ref saveCheckpoint
+   *
+   * @retval true if the checkpoint is successfully loaded
+   * @retval false if the checkpoint is broken or it is for another TA, e.g., an edited TA or the TA preprocessed differently. In this case, the state is not changed.
+   */
+  bool loadCheckpoint(std::istream &is) {
+    char magic[sizeof(checkpointMagic)];
+    uint32_t version;
+    uint64_t clockSize, stateSize, fingerprint;
+    if (!is.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), checkpointMagic) ||
+        !readBinary(is, version) || version != checkpointVersion ||
+        !readBinary(is, clockSize) || clockSize != numOfClockVariables ||
+        !readBinary(is, stateSize) || stateSize != boost::num_vertices(TA) ||
+        !readBinary(is, fingerprint) || fingerprint != automatonFingerprint(TA)) {
+      return false;
+    }
+    double newAbsTime, newWatermark, newLastApproximationTime;
+    uint64_t size;
+    if (!readBinary(is, newAbsTime) || !readBinary(is, newWatermark) ||
+        !readBinary(is, newLastApproximationTime) || !readBinary(is, size)) {
+      return false;
+    }
+
+    // The sizes are bounded by the bytes left before allocating the memory. Each piece takes at least its size.
+    // The bytes left are computed only once since seeking an std::ifstream drops its buffer.
+    std::size_t remaining = remainingBytes(is);
+    if (size > remaining / sizeof(uint64_t)) {
+      return false;
+    }
+    // The pieces are numbered from 0 in the restored store
+    PieceStore<Value> newPieces;
+    std::vector<Value> valuation;
+    for (uint64_t i = 0; i < size; i++) {
+      uint64_t valuationSize;
+      // All the pieces have the width of the signal
+      if (!readBinary(is, valuationSize) || (i > 0 && valuationSize != valuation.size())) {
+        return false;
+      }
+      remaining -= sizeof(uint64_t);
+      if (valuationSize > remaining / sizeof(Value)) {
+        return false;
+      }
+      valuation.resize(valuationSize);
+      if (!is.read(reinterpret_cast<char*>(valuation.data()), sizeof(Value) * valuationSize)) {
+        return false;
+      }
+      remaining -= sizeof(Value) * valuationSize;
+      newPieces.push(valuation);
+    }
+
+    // Each configuration takes at least its TA state, its flag, the dimension of its zone, and its history
+    constexpr std::size_t minConfigurationBytes = sizeof(uint64_t) * 3 + sizeof(uint8_t) + sizeof(uint32_t);
+    if (!readBinary(is, size) || size > (remaining - sizeof(uint64_t)) / minConfigurationBytes) {
+      return false;
+    }
+    Conf_t newConfiguration;
+    newConfiguration.reserve(size);
+    for (uint64_t i = 0; i < size; i++) {
+      uint64_t vertex, historyBegin, historySize;
+      uint8_t jumpable;
+      DBM zone;
+      if (!readBinary(is, vertex) || vertex >= stateSize || !readBinary(is, jumpable) ||
+          !readBinary(is, zone, initialZone.value.cols()) ||
+          !readBinary(is, historyBegin) || !readBinary(is, historySize) ||
+          historyBegin > newPieces.getEnd() || historySize > newPieces.getEnd() - historyBegin) {
+        return false;
+      }
+      decltype(Weight::one().data) weight;
+      if (!readBinary(is, weight)) {
+        return false;
+      }
+      newConfiguration.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{TAState(vertex), bool(jumpable), std::move(zone), PieceRange{historyBegin, historyBegin + historySize}}, Weight(weight));
+    }
+
+    boost::unordered_map<ResultMatrix, Weight> newResult;
+    if (!readBinary(is, size)) {
+      return false;
+    }
+    for (uint64_t i = 0; i < size; i++) {
+      ResultMatrix mat;
+      for (Bounds &b: mat) {
+        if (!readBinary(is, b)) {
+          return false;
+        }
+      }
+      decltype(Weight::one().data) weight;
+      if (!readBinary(is, weight)) {
+        return false;
+      }
+      newResult[std::move(mat)] = Weight(weight);
+    }
+
+    configuration = std::move(newConfiguration);
+    pieces = std::move(newPieces);
+    result = std::move(newResult);
+    absTime = newAbsTime;
+    watermark = newWatermark;
+    lastApproximationTime = newLastApproximationTime;
+    return true;
+  }
+
+  //! @brief The absolute time at the end of the signal fed so far
+  double getAbsTime() const {
+    return absTime;
+  }
+
+  //! @brief The number of the current configurations
+  std::size_t getNumOfConfigurations() const {
+    return configuration.size();
+  }
+
+  //! @brief The maximum number of the configurations after a piece fed so far
+  std::size_t getPeakNumOfConfigurations() const {
+    return peakNumOfConfigurations;
+  }
+
+  //! @brief The earliest start time of the matching that is not finalized yet
+  double getWatermark() const {
+    return watermark;
+  }
+
   void getResult(boost::unordered_map<ResultMatrix, Weight> &v) const {
     v = result;
   }
@@ -230,3 +1006,10 @@ public:
     return result;
   }
 };
+
+template<class SignalVariables, class ClockVariables, class Weight, class Value>
+constexpr const char QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value>::checkpointMagic[8];
+template<class SignalVariables, class ClockVariables, class Weight, class Value>
+constexpr uint32_t QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value>::checkpointVersion;
+template<class SignalVariables, class ClockVariables, class Weight, class Value>
+constexpr std::size_t QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value>::sparseStartInterval;
@@ -0,0 +1,530 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <boost/optional.hpp>
+
+#include "dbm.hh"
+#include "ring_buffer.hh"
+
+//! @brief The formats of the result
+enum class ResultFormat {
+  //! @brief The human-readable blocks
+  text,
+  //! @brief One match per line with the header line
+  csv,
+  //! @brief One JSON object per line
+  jsonl,
+  //! @brief The binary records with the magic
+  binary
+};
+
+//! @brief The format of the given name. If the name is unknown, boost::none is returned.
+static inline boost::optional<ResultFormat> parseResultFormat(const std::string &name) {
+  if (name == "text") {
+    return ResultFormat::text;
+  } else if (name == "csv") {
+    return ResultFormat::csv;
+  } else if (name == "jsonl") {
+    return ResultFormat::jsonl;
+  } else if (name == "binary") {
+    return ResultFormat::binary;
+  }
+  return boost::none;
+}
+
+/*!
+  @brief Append a number in the same way as printf("%lf")
+
+  The number is rounded to 6 decimal places by the integer arithmetic if it is small and not close to a tie, where the result is the same as printf. Otherwise, snprintf is used.
+
+  @param [in] trim If we remove the trailing zeros of the fractional part, e.g., "2.5" instead of "2.500000"
+ */
+static inline void appendFixed(std::string &buffer, double x, bool trim = false) {
+  // |x| * 10^6 < 2^40 so that the error of the multiplication is much smaller than the distance to a tie
+  constexpr double limit = double(uint64_t(1) << 40) / 1e6;
+  const double scaled = std::abs(x) * 1e6;
+  const double rounded = std::nearbyint(scaled);
+  const std::size_t begin = buffer.size();
+  if (std::abs(x) < limit && std::abs(std::abs(scaled - rounded) - 0.5) > 1e-3) {
+    char str[32];
+    uint64_t value = uint64_t(rounded);
+    // Write the digits from the last one
+    char *p = str + sizeof(str);
+    for (int i = 0; i < 6; i++) {
+      *--p = '0' + value % 10;
+      value /= 10;
+    }
+    *--p = '.';
+    do {
+      *--p = '0' + value % 10;
+      value /= 10;
+    } while (value > 0);
+    if (std::signbit(x)) {
+      *--p = '-';
+    }
+    buffer.append(p, str + sizeof(str));
+  } else {
+    const int size = snprintf(nullptr, 0, "%lf", x);
+    buffer.resize(begin + size + 1);
+    snprintf(&buffer[begin], size + 1, "%lf", x);
+    buffer.resize(begin + size);
+  }
+  if (trim && buffer.find('.', begin) != std::string::npos) {
+    while (buffer.back() == '0') {
+      buffer.pop_back();
+    }
+    if (buffer.back() == '.') {
+      buffer.pop_back();
+    }
+    if (buffer.compare(begin, std::string::npos, "-0") == 0) {
+      // "-0" is written as "0"
+      buffer.erase(begin, 1);
+    }
+  }
+}
+
+//! @brief Append a number right-aligned to the width in the same way as printf("%10lf")
+static inline void appendFixedWidth(std::string &buffer, double x, std::size_t width) {
+  const std::size_t begin = buffer.size();
+  appendFixed(buffer, x);
+  const std::size_t size = buffer.size() - begin;
+  if (size < width) {
+    buffer.insert(begin, width - size, ' ');
+  }
+}
+
+/*!
+  @brief The stage of a pipeline writing the formatted result in a background thread
+
+  The buffers are handed over through a ring buffer and written in the given order. The memory of the written buffers is given back to the producer.
+ */
+class OutputThread {
+public:
+  //! @param [in] capacity The maximum number of the buffers not written yet
+  explicit OutputThread(std::size_t capacity = 16) : chunks(capacity) {
+    thread = std::thread([this] {
+        Chunk chunk;
+        while (chunks.pop(chunk)) {
+          fwrite(chunk.data.data(), 1, chunk.data.size(), chunk.out);
+          chunk.data.clear();
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            numOfWritten++;
+          }
+          written.notify_all();
+        }
+      });
+  }
+
+  OutputThread(const OutputThread &) = delete;
+  OutputThread &operator=(const OutputThread &) = delete;
+
+  ~OutputThread() {
+    finish();
+  }
+
+  //! @brief Write all the given buffers and stop the thread
+  void finish() {
+    chunks.close();
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  /*!
+    @brief Give the buffer to be written to the file
+
+    @param [in,out] data The buffer to write. It is swapped with an empty buffer written before.
+    @note Only one thread gives the buffers.
+   */
+  void write(FILE *out, std::string &data) {
+    spare.out = out;
+    std::swap(spare.data, data);
+    if (!chunks.push(spare)) {
+      // After finish, the buffer is written by the caller
+      fwrite(spare.data.data(), 1, spare.data.size(), out);
+      spare.data.clear();
+      std::swap(spare.data, data);
+      return;
+    }
+    numOfSubmitted++;
+  }
+
+  //! @brief Wait until all the given buffers are written
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [this] { return numOfWritten == numOfSubmitted; });
+  }
+
+  std::size_t capacity() const {
+    return chunks.capacity();
+  }
+
+  /*!
+    @brief The statistics of the buffers waiting to be written
+
+    @pre @ref finish is called
+   */
+  const RingBufferStats &getStats() const {
+    return chunks.getStats();
+  }
+
+private:
+  struct Chunk {
+    FILE *out = nullptr;
+    std::string data;
+  };
+  RingBuffer<Chunk> chunks;
+  //! @brief The chunk swapped with the ring buffer
+  Chunk spare;
+  std::size_t numOfSubmitted = 0;
+  std::size_t numOfWritten = 0;
+  std::mutex mutex;
+  std::condition_variable written;
+  std::thread thread;
+};
+
+/*!
+  @brief Write the matching in the selected format through a buffer
+
+  The formatted matching is kept in the buffer until @ref flush, which writes it by one fwrite call. If a background thread is given, the buffer is written by the thread so that the matching is not blocked by the I/O. The writes of the writers sharing a background thread keep their order because the thread processes them one by one.
+ */
+class ResultWriter {
+public:
+  //! @brief The magic of the binary format followed by the records
+  static constexpr const char *binaryMagic = "QTPMRES1";
+
+  /*!
+    @param [in] out The file to write the matching to
+    @param [in] tag The name of the automaton printed with each matching. If it is empty, it is omitted.
+    @param [in] background The thread writing the buffer. If it is nullptr, the buffer is written in @ref flush.
+    @pre The writers sharing background are used by one thread.
+   */
+  ResultWriter(FILE *out, ResultFormat format, std::string tag, OutputThread *background = nullptr) :
+    out(out), format(format), tag(std::move(tag)), background(background) {}
+
+  ResultWriter(const ResultWriter &) = delete;
+  ResultWriter &operator=(const ResultWriter &) = delete;
+
+  ~ResultWriter() {
+    flush();
+    wait();
+  }
+
+  /*!
+    @brief The lines written once at the beginning of the output
+
+    The header is not written by the writer because the writers of several automata share the output.
+   */
+  static std::string header(ResultFormat format) {
+    switch (format) {
+    case ResultFormat::csv:
+      return "automaton,weight,approximate,"
+        "t_lower,t_lower_closed,t_upper,t_upper_closed,"
+        "tp_lower,tp_lower_closed,tp_upper,tp_upper_closed,"
+        "duration_lower,duration_lower_closed,duration_upper,duration_upper_closed\n";
+    case ResultFormat::binary:
+      return std::string(binaryMagic, 8);
+    default:
+      return "";
+    }
+  }
+
+  //! @brief Write a matching with its weight
+  void writeMatch(const std::array<Bounds, 6> &arr, double weight, bool approximate) {
+    write(arr, weight, approximate, true);
+  }
+
+  //! @brief Write a matching in the Boolean semantics. The matching of weight false is omitted.
+  void writeMatch(const std::array<Bounds, 6> &arr, bool weight, bool approximate) {
+    if (weight) {
+      write(arr, 1, approximate, false);
+    }
+  }
+
+  //! @brief Write a degraded interval [begin, end) (see QuantitativeTimedPatternMatching::setLatencyBudget)
+  void writeDegraded(double begin, double end) {
+    switch (format) {
+    case ResultFormat::text:
+      appendTag();
+      buffer += "----- Degraded: ";
+      appendFixed(buffer, begin);
+      buffer += " <= time < ";
+      appendFixed(buffer, end);
+      buffer += " -----\n";
+      break;
+    case ResultFormat::csv:
+      // A comment line
+      buffer += "# degraded,";
+      buffer += tag;
+      buffer += ',';
+      appendFixed(buffer, begin, true);
+      buffer += ',';
+      appendFixed(buffer, end, true);
+      buffer += '\n';
+      break;
+    case ResultFormat::jsonl:
+      buffer += '{';
+      appendJSONTag();
+      buffer += "\"degraded\":{\"begin\":";
+      appendJSONNumber(begin);
+      buffer += ",\"end\":";
+      appendJSONNumber(end);
+      buffer += "}}\n";
+      break;
+    case ResultFormat::binary:
+      appendBinaryRecordHeader(1, 0);
+      appendBinary(begin);
+      appendBinary(end);
+      break;
+    }
+  }
+
+  //! @brief Write the buffer to the file or give it to the background thread
+  void flush() {
+    if (buffer.empty()) {
+      return;
+    }
+    if (background) {
+      // The memory usage is bounded by the capacity of the background thread
+      background->write(out, buffer);
+    } else {
+      fwrite(buffer.data(), 1, buffer.size(), out);
+      buffer.clear();
+    }
+  }
+
+  //! @brief Wait for the write by the background thread
+  void wait() {
+    if (background) {
+      background->wait();
+    }
+  }
+
+  //! @brief Change the file to write to after writing the current buffer
+  void setOutput(FILE *newOut) {
+    flush();
+    wait();
+    out = newOut;
+  }
+
+private:
+  FILE *out;
+  const ResultFormat format;
+  const std::string tag;
+  OutputThread *background;
+  std::string buffer;
+
+  void write(const std::array<Bounds, 6> &arr, double weight, bool approximate, bool hasWeight) {
+    switch (format) {
+    case ResultFormat::text: {
+      appendTag();
+      if (approximate) {
+        buffer += "----- Possibly over-approximated -----\n";
+      }
+      if (hasWeight) {
+        buffer += "----- Weight: ";
+        appendFixed(buffer, weight);
+        buffer += " -----\n";
+      }
+      static const char *names[] = {" t ", " t' ", " t' - t "};
+      for (int i = 0; i < 3; i++) {
+        // The same as printf("%10lf %8s t %s %10lf\n")
+        appendFixedWidth(buffer, -arr[2 * i].first, 10);
+        buffer += arr[2 * i].second ? "       <=" : "        <";
+        buffer += names[i];
+        buffer += arr[2 * i + 1].second ? "<= " : "< ";
+        appendFixedWidth(buffer, arr[2 * i + 1].first, 10);
+        buffer += '\n';
+      }
+      buffer += "=============================\n";
+      break;
+    }
+    case ResultFormat::csv:
+      buffer += tag;
+      buffer += ',';
+      appendFixed(buffer, weight, true);
+      buffer += approximate ? ",1" : ",0";
+      for (int i = 0; i < 6; i++) {
+        buffer += ',';
+        appendFixed(buffer, i % 2 == 0 ? -arr[i].first : arr[i].first, true);
+        buffer += arr[i].second ? ",1" : ",0";
+      }
+      buffer += '\n';
+      break;
+    case ResultFormat::jsonl: {
+      buffer += '{';
+      appendJSONTag();
+      buffer += "\"weight\":";
+      appendJSONNumber(weight);
+      buffer += approximate ? ",\"approximate\":true" : ",\"approximate\":false";
+      static const char *names[] = {"t", "tp", "duration"};
+      for (int i = 0; i < 3; i++) {
+        buffer += ",\"";
+        buffer += names[i];
+        buffer += "\":{\"lower\":";
+        appendJSONNumber(-arr[2 * i].first);
+        buffer += arr[2 * i].second ? ",\"lower_closed\":true" : ",\"lower_closed\":false";
+        buffer += ",\"upper\":";
+        appendJSONNumber(arr[2 * i + 1].first);
+        buffer += arr[2 * i + 1].second ? ",\"upper_closed\":true}" : ",\"upper_closed\":false}";
+      }
+      buffer += "}\n";
+      break;
+    }
+    case ResultFormat::binary: {
+      uint8_t flags = approximate ? 1 << 6 : 0;
+      for (int i = 0; i < 6; i++) {
+        flags |= arr[i].second ? 1 << i : 0;
+      }
+      appendBinaryRecordHeader(0, flags);
+      appendBinary(weight);
+      for (int i = 0; i < 6; i++) {
+        appendBinary(i % 2 == 0 ? -arr[i].first : arr[i].first);
+      }
+      break;
+    }
+    }
+  }
+
+  void appendTag() {
+    if (!tag.empty()) {
+      buffer += "----- Automaton: ";
+      buffer += tag;
+      buffer += " -----\n";
+    }
+  }
+
+  void appendJSONTag() {
+    if (!tag.empty()) {
+      // The tag is a file name and a semiring. We escape only the characters that can appear in them.
+      buffer += "\"automaton\":\"";
+      for (const char c: tag) {
+        if (c == '"' || c == '\\') {
+          buffer += '\\';
+        }
+        buffer += c;
+      }
+      buffer += "\",";
+    }
+  }
+
+  //! @brief Append a number. Since JSON has no infinity, it is written as the string "inf" or "-inf".
+  void appendJSONNumber(double x) {
+    if (std::isinf(x)) {
+      buffer += x > 0 ? "\"inf\"" : "\"-inf\"";
+    } else {
+      appendFixed(buffer, x, true);
+    }
+  }
+
+  template<class T>
+  void appendBinary(const T &x) {
+    buffer.append(reinterpret_cast<const char *>(&x), sizeof(T));
+  }
+
+  //! @brief The kind of the record (0: matching, 1: degraded interval), the flags, and the tag
+  void appendBinaryRecordHeader(uint8_t kind, uint8_t flags) {
+    appendBinary(kind);
+    appendBinary(flags);
+    appendBinary(uint16_t(tag.size()));
+    buffer += tag;
+  }
+};
+
+/*!
+  @brief Decode the result in the binary format given incrementally, e.g., from a socket
+
+  @sa ResultWriter
+ */
+class BinaryResultDecoder {
+public:
+  //! @brief A record of the binary result
+  struct Record {
+    //! @brief 0: matching, 1: degraded interval
+    uint8_t kind;
+    bool approximate;
+    std::string tag;
+    double weight;
+    std::array<Bounds, 6> bounds;
+    //! @brief The degraded interval [begin, end)
+    double begin;
+    double end;
+  };
+
+  //! @brief Append the bytes received
+  void append(const char *data, std::size_t size) {
+    buffer.append(data, size);
+  }
+
+  /*!
+    @brief Take the next complete record
+
+    @returns false if no complete record is received yet
+    @throws std::runtime_error If the bytes are not a binary result
+   */
+  bool next(Record &record) {
+    if (!hasMagic) {
+      if (buffer.size() - position < 8) {
+        return false;
+      }
+      if (buffer.compare(position, 8, ResultWriter::binaryMagic) != 0) {
+        throw std::runtime_error("not a binary result");
+      }
+      position += 8;
+      hasMagic = true;
+    }
+    // kind, flags, and the length of the tag
+    constexpr std::size_t headerSize = 4;
+    if (buffer.size() - position < headerSize) {
+      return false;
+    }
+    const uint8_t kind = buffer[position];
+    const uint8_t flags = buffer[position + 1];
+    uint16_t tagSize;
+    std::memcpy(&tagSize, &buffer[position + 2], sizeof(tagSize));
+    if (kind > 1) {
+      throw std::runtime_error("unknown kind of a record " + std::to_string(kind));
+    }
+    const std::size_t numOfValues = kind == 0 ? 7 : 2;
+    if (buffer.size() - position < headerSize + tagSize + numOfValues * sizeof(double)) {
+      return false;
+    }
+    record.kind = kind;
+    record.approximate = flags & (1 << 6);
+    record.tag.assign(buffer, position + headerSize, tagSize);
+    const char *values = &buffer[position + headerSize + tagSize];
+    const auto value = [values](std::size_t i) {
+      double x;
+      std::memcpy(&x, values + i * sizeof(double), sizeof(double));
+      return x;
+    };
+    if (kind == 0) {
+      record.weight = value(0);
+      for (int i = 0; i < 6; i++) {
+        record.bounds[i] = Bounds(i % 2 == 0 ? -value(i + 1) : value(i + 1), flags & (1 << i));
+      }
+    } else {
+      record.begin = value(0);
+      record.end = value(1);
+    }
+    position += headerSize + tagSize + numOfValues * sizeof(double);
+    if (position * 2 > buffer.size()) {
+      // Drop the decoded bytes
+      buffer.erase(0, position);
+      position = 0;
+    }
+    return true;
+  }
+
+private:
+  std::string buffer;
+  //! @brief The beginning of the bytes not decoded yet
+  std::size_t position = 0;
+  bool hasMagic = false;
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//! @brief The statistics of a ring buffer to find the bottleneck of a pipeline
+struct RingBufferStats {
+  //! @brief The number of the items put
+  std::size_t numOfItems = 0;
+  //! @brief The sum of the number of the items in the buffer right after each put
+  double occupancySum = 0;
+  //! @brief The seconds the producer waited for the buffer not full, i.e., the consumer is the bottleneck
+  double producerWaitSeconds = 0;
+  //! @brief The seconds the consumer waited for the buffer not empty, i.e., the producer is the bottleneck
+  double consumerWaitSeconds = 0;
+
+  double meanOccupancy() const {
+    return numOfItems > 0 ? occupancySum / numOfItems : 0;
+  }
+};
+
+/*!
+  @brief A bounded lock-free buffer between one producer thread and one consumer thread
+
+  The items are exchanged by swapping with the slots so that the memory of an item, e.g., a vector, is reused after it is consumed. The producer and the consumer exchange only the indices by atomic operations. Only when the buffer is full (resp. empty), the producer (resp. consumer) sleeps on a condition variable after a short spin, and the other side takes the lock only if it is sleeping.
+ */
+template<class T>
+class RingBuffer {
+public:
+  explicit RingBuffer(std::size_t capacity) : slots(std::max<std::size_t>(1, capacity)) {}
+
+  /*!
+    @brief Put an item, waiting while the buffer is full
+
+    @param [in,out] item The item to put. It is swapped with an item consumed before.
+    @returns false if the buffer is closed
+    @note Only the producer thread calls this.
+   */
+  bool push(T &item) {
+    const std::size_t currentTail = tail.load(std::memory_order_relaxed);
+    const auto isNotFull = [&] {
+      return currentTail - head.load(std::memory_order_acquire) < slots.size();
+    };
+    if (!isNotFull()) {
+      wait(producerWaiting, notFull, isNotFull, stats.producerWaitSeconds);
+    }
+    if (closed.load(std::memory_order_acquire)) {
+      return false;
+    }
+    std::swap(slots[currentTail % slots.size()], item);
+    tail.store(currentTail + 1, std::memory_order_release);
+    stats.numOfItems++;
+    stats.occupancySum += currentTail + 1 - head.load(std::memory_order_relaxed);
+    wake(consumerWaiting, notEmpty);
+    return true;
+  }
+
+  /*!
+    @brief Take an item, waiting while the buffer is empty
+
+    @param [in,out] item The taken item. The given item is swapped into the buffer for reuse.
+    @returns false if the buffer is closed and empty
+    @note Only the consumer thread calls this.
+   */
+  bool pop(T &item) {
+    const std::size_t currentHead = head.load(std::memory_order_relaxed);
+    const auto isNotEmpty = [&] {
+      return tail.load(std::memory_order_acquire) != currentHead;
+    };
+    if (!isNotEmpty()) {
+      wait(consumerWaiting, notEmpty, isNotEmpty, stats.consumerWaitSeconds);
+      if (!isNotEmpty()) {
+        return false;
+      }
+    }
+    std::swap(slots[currentHead % slots.size()], item);
+    head.store(currentHead + 1, std::memory_order_release);
+    wake(producerWaiting, notFull);
+    return true;
+  }
+
+  /*!
+    @brief Close the buffer
+
+    The producer closes it at the end of the items, and the consumer closes it to stop the producer. The items already put can still be taken.
+   */
+  void close() {
+    closed.store(true);
+    std::lock_guard<std::mutex> lock(mutex);
+    notEmpty.notify_all();
+    notFull.notify_all();
+  }
+
+  std::size_t capacity() const {
+    return slots.size();
+  }
+
+  /*!
+    @brief The statistics of the buffer
+
+    @pre Both the producer and the consumer are finished
+   */
+  const RingBufferStats &getStats() const {
+    return stats;
+  }
+
+private:
+  //! @brief The number of the yields before sleeping
+  static constexpr int spins = 64;
+  std::vector<T> slots;
+  //! @brief The number of the items taken so far. It is written only by the consumer.
+  std::atomic<std::size_t> head = {0};
+  //! @brief The number of the items put so far. It is written only by the producer.
+  std::atomic<std::size_t> tail = {0};
+  std::atomic<bool> closed = {false};
+  std::atomic<bool> producerWaiting = {false};
+  std::atomic<bool> consumerWaiting = {false};
+  std::mutex mutex;
+  std::condition_variable notEmpty;
+  std::condition_variable notFull;
+  RingBufferStats stats;
+
+  //! @brief Wait until ready() holds or the buffer is closed
+  template<class Predicate>
+  void wait(std::atomic<bool> &waiting, std::condition_variable &cond, const Predicate &ready, double &seconds) {
+    const auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < spins && !ready() && !closed.load(std::memory_order_acquire); i++) {
+      std::this_thread::yield();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      waiting.store(true, std::memory_order_relaxed);
+      // Pairs with the fence in wake: either we see the new index or the other side sees waiting
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      cond.wait(lock, [&] { return ready() || closed.load(std::memory_order_acquire); });
+      waiting.store(false, std::memory_order_relaxed);
+    }
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  }
+
+  //! @brief Wake up the other side if it is sleeping
+  void wake(std::atomic<bool> &waiting, std::condition_variable &cond) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(mutex);
+      cond.notify_one();
+    }
+  }
+};
@@ -22,8 +22,13 @@ Weight singleSpaceRobustness(const std::vector<Constraint<ClockVariables>> &labe
     });
 }
 
-template<class Weight, class Value, class ClockVariables>
-Weight multipleSpaceRobustness(const std::vector<Constraint<ClockVariables>> &label, const std::vector<std::vector<Value>> &valuations) {
+/*!
+  @brief The space robustness of a label over the valuations of several pieces
+
+  @tparam Valuations A range of std::vector<Value>, e.g., std::vector<std::vector<Value>> or PieceHistory<Value>
+ */
+template<class Weight, class Value, class ClockVariables, class Valuations = std::vector<std::vector<Value>>>
+Weight multipleSpaceRobustness(const std::vector<Constraint<ClockVariables>> &label, const Valuations &valuations) {
   return std::accumulate(valuations.begin(), valuations.end(), Weight::one(), [&label](Weight init, const std::vector<Value> &valuation) {
       return init * singleSpaceRobustness<Weight>(label, valuation);
     });
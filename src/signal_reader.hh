@@ -0,0 +1,621 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include <exception>
+#include <istream>
+#include <thread>
+#include <boost/optional.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/file_descriptor.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/bzip2.hpp>
+#ifdef QTPM_HAVE_ZSTD
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ring_buffer.hh"
+
+/*!
+  @brief Parse a decimal floating point number in [begin, end)
+
+  The number with at most 19 significant digits and a small exponent is computed exactly by one multiplication or division of two exactly representable numbers (Clinger's fast path). The other numbers, e.g., with many digits or "inf", are parsed by strtod.
+
+  @returns If the whole range is a number
+ */
+static inline bool parseDouble(const char *begin, const char *end, double &value) {
+  static constexpr double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                           1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char *p = begin;
+  const bool negative = p != end && *p == '-';
+  if (p != end && (*p == '-' || *p == '+')) {
+    p++;
+  }
+  uint64_t mantissa = 0;
+  int numOfDigits = 0;
+  int exponent = 0;
+  bool hasDigits = false;
+  for (; p != end && *p >= '0' && *p <= '9'; p++) {
+    hasDigits = true;
+    if (mantissa == 0 && *p == '0') {
+      continue;
+    }
+    mantissa = mantissa * 10 + (*p - '0');
+    numOfDigits++;
+  }
+  if (p != end && *p == '.') {
+    for (p++; p != end && *p >= '0' && *p <= '9'; p++) {
+      hasDigits = true;
+      if (mantissa == 0 && *p == '0') {
+        exponent--;
+        continue;
+      }
+      mantissa = mantissa * 10 + (*p - '0');
+      numOfDigits++;
+      exponent--;
+    }
+  }
+  if (hasDigits && p != end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    const bool negativeExponent = q != end && *q == '-';
+    if (q != end && (*q == '-' || *q == '+')) {
+      q++;
+    }
+    int explicitExponent = 0;
+    bool hasExponentDigits = false;
+    for (; q != end && *q >= '0' && *q <= '9'; q++) {
+      hasExponentDigits = true;
+      if (explicitExponent < 10000) {
+        explicitExponent = explicitExponent * 10 + (*q - '0');
+      }
+    }
+    if (hasExponentDigits) {
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
+      p = q;
+    }
+  }
+  if (hasDigits && p == end && numOfDigits <= 19 && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+    value = double(mantissa);
+    value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+    value = negative ? -value : value;
+    return true;
+  }
+
+  // The slow path. strtod requires a null-terminated string.
+  const std::string token(begin, end);
+  char *parsedEnd;
+  value = std::strtod(token.c_str(), &parsedEnd);
+  return !token.empty() && parsedEnd == token.c_str() + token.size();
+}
+
+/*!
+  @brief The source of a signal, where each piece is the time followed by the values of the signal variables
+
+  A regular file is memory-mapped. The other files, e.g., the standard input or a pipe, are read by a buffer, and each piece is returned as soon as it arrives for online monitoring.
+ */
+class SignalReader {
+public:
+  /*!
+    @param [in] file The file to read. It is not closed by the reader.
+    @param [in] fileName The name of the file used in the error message
+    @param [in] source The stream of the decompressed file. If it is given, the bytes are read from it instead of the file.
+   */
+  SignalReader(FILE *file, std::string fileName, std::unique_ptr<std::istream> source = nullptr) :
+    fileName(std::move(fileName)), fd(fileno(file)), source(std::move(source)) {
+    struct stat st;
+    if (!this->source && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        mapped = static_cast<const char *>(p);
+        mappedSize = st.st_size;
+        current = mapped;
+        end = mapped + mappedSize;
+      }
+    }
+  }
+
+  SignalReader(const SignalReader &) = delete;
+  SignalReader &operator=(const SignalReader &) = delete;
+
+  virtual ~SignalReader() {
+    if (mapped) {
+      munmap(const_cast<char *>(mapped), mappedSize);
+    }
+  }
+
+  /*!
+    @brief Read the next piece
+
+    @param [out] time The duration or the timestamp of the piece
+    @param [out] valuation The values of the signal variables
+    @returns false if no piece is left
+    @throws std::runtime_error If the input is malformed. The message contains the file name and the position.
+   */
+  virtual bool next(double &time, std::vector<double> &valuation) = 0;
+
+  //! @brief If the time is the absolute time. If the file does not specify it, boost::none is returned.
+  virtual boost::optional<bool> isAbsTime() const {
+    return boost::none;
+  }
+
+  const std::string &getFileName() const {
+    return fileName;
+  }
+
+protected:
+  const std::string fileName;
+  //! @brief The unread range of the mapped file or the buffer
+  const char *current = nullptr;
+  const char *end = nullptr;
+
+  /*!
+    @brief Read more bytes to the buffer keeping the unread ones at its beginning
+
+    @returns false if no more byte is available
+   */
+  bool readMore() {
+    if (mapped || isEOF || fd < 0) {
+      return false;
+    }
+    constexpr std::size_t chunkSize = 1 << 16;
+    const std::size_t remaining = end - current;
+    if (remaining > 0 && current != buffer.data()) {
+      std::memmove(buffer.data(), current, remaining);
+    }
+    // The buffer grows when a line is longer than it
+    if (buffer.size() < remaining + chunkSize) {
+      buffer.resize(remaining + chunkSize);
+    }
+    ssize_t size;
+    if (source) {
+      try {
+        source->read(buffer.data() + remaining, buffer.size() - remaining);
+      } catch (const std::exception &e) {
+        throw std::runtime_error(fileName + ": " + e.what());
+      }
+      size = source->gcount();
+    } else {
+      do {
+        size = read(fd, buffer.data() + remaining, buffer.size() - remaining);
+      } while (size < 0 && errno == EINTR);
+      if (size < 0) {
+        throw std::runtime_error(fileName + ": " + std::strerror(errno));
+      }
+    }
+    isEOF = size == 0;
+    current = buffer.data();
+    end = buffer.data() + remaining + size;
+    return !isEOF;
+  }
+
+  //! @brief Make at least size bytes available in [current, end). @returns false if the file ends before.
+  bool ensure(std::size_t size) {
+    while (std::size_t(end - current) < size) {
+      if (!readMore()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! @brief For the reader taking the pieces from another reader. It reads no byte by itself.
+  explicit SignalReader(std::string fileName) : fileName(std::move(fileName)), fd(-1) {}
+
+private:
+  const int fd;
+  //! @brief The decompressed stream of the file. If it is nullptr, the file is read directly.
+  const std::unique_ptr<std::istream> source;
+  //! @brief The memory-mapped file. If it is nullptr, we read the file by buffer.
+  const char *mapped = nullptr;
+  std::size_t mappedSize = 0;
+  //! @brief The buffer used when the file is not memory-mapped
+  std::vector<char> buffer;
+  bool isEOF = false;
+};
+
+/*!
+  @brief Read a signal in the text format line by line
+
+  Each line is tokenized in place. The columns are separated by spaces or tabs. The length of a line is not limited. Empty lines are skipped.
+ */
+class TextSignalReader : public SignalReader {
+public:
+  using SignalReader::SignalReader;
+
+  /*!
+    @copydoc SignalReader::next
+
+    The error message contains the line number.
+   */
+  bool next(double &time, std::vector<double> &valuation) override {
+    valuation.clear();
+    const char *lineBegin, *lineEnd;
+    do {
+      if (!nextLine(lineBegin, lineEnd)) {
+        return false;
+      }
+      lineNumber++;
+      // skip the leading white spaces
+      while (lineBegin != lineEnd && isSpace(*lineBegin)) {
+        lineBegin++;
+      }
+    } while (lineBegin == lineEnd);
+
+    bool isTime = true;
+    for (const char *p = lineBegin; p != lineEnd;) {
+      const char *tokenEnd = p;
+      while (tokenEnd != lineEnd && !isSpace(*tokenEnd)) {
+        tokenEnd++;
+      }
+      double v;
+      if (!parseDouble(p, tokenEnd, v)) {
+        throw std::runtime_error(fileName + ":" + std::to_string(lineNumber) + ": malformed number \"" + std::string(p, tokenEnd) + "\"");
+      }
+      if (isTime) {
+        time = v;
+        isTime = false;
+      } else {
+        valuation.push_back(v);
+      }
+      for (p = tokenEnd; p != lineEnd && isSpace(*p); p++);
+    }
+    return true;
+  }
+
+  //! @brief The number of the lines read so far
+  std::size_t getLineNumber() const {
+    return lineNumber;
+  }
+
+private:
+  std::size_t lineNumber = 0;
+
+  static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  //! @brief Find the next line [lineBegin, lineEnd) without the newline
+  bool nextLine(const char *&lineBegin, const char *&lineEnd) {
+    const char *newline = nullptr;
+    while (current == end || !(newline = static_cast<const char *>(std::memchr(current, '\n', end - current)))) {
+      if (!readMore()) {
+        // The last line without a newline
+        if (current == end) {
+          return false;
+        }
+        lineBegin = current;
+        lineEnd = end;
+        current = end;
+        return true;
+      }
+    }
+    lineBegin = current;
+    lineEnd = newline;
+    current = newline + 1;
+    return true;
+  }
+};
+
+/*!
+  @brief Read a signal in the binary format
+
+  The file begins with a @ref Header followed by the pieces in one of the following layouts. All the numbers are little-endian, and the time and the values are of the type in the header.
+  - records: each piece is the time followed by the values.
+  - column blocks: each block is the number of the pieces in it (uint32_t), the times of the pieces, and then the values of each signal variable in the pieces.
+ */
+class BinarySignalReader : public SignalReader {
+public:
+  enum class ValueType : uint8_t {
+    float32 = 0,
+    float64 = 1
+  };
+  enum class Layout : uint8_t {
+    records = 0,
+    columnBlocks = 1
+  };
+  //! @brief The header of the binary signal
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    //! @brief The number of the signal variables
+    uint32_t numOfVariables;
+    //! @brief 1 if the time is the absolute time and 0 if it is the duration
+    uint8_t isAbsTime;
+    ValueType valueType;
+    Layout layout;
+    uint8_t reserved;
+  };
+  static_assert(sizeof(Header) == 20, "the header must be packed");
+  //! @brief The first 8 bytes of the header
+  static constexpr const char *headerMagic = "QTPMSIGN";
+  static constexpr uint32_t formatVersion = 1;
+  //! @brief The maximum number of the signal variables. A wider header is considered broken.
+  static constexpr uint32_t maxNumOfVariables = 1 << 16;
+
+  //! @brief The header of a binary signal of the current version
+  static Header makeHeader(uint32_t numOfVariables, bool isAbsTime, ValueType valueType, Layout layout) {
+    Header header;
+    std::memcpy(header.magic, headerMagic, sizeof(header.magic));
+    header.version = formatVersion;
+    header.numOfVariables = numOfVariables;
+    header.isAbsTime = isAbsTime;
+    header.valueType = valueType;
+    header.layout = layout;
+    header.reserved = 0;
+    return header;
+  }
+
+  /*!
+    @copydoc SignalReader::SignalReader
+    @throws std::runtime_error If the header is invalid, e.g., it has more than @ref maxNumOfVariables signal variables
+   */
+  BinarySignalReader(FILE *file, std::string fileName, std::unique_ptr<std::istream> source = nullptr) :
+    SignalReader(file, std::move(fileName), std::move(source)) {
+    if (!ensure(sizeof(Header))) {
+      throw std::runtime_error(this->fileName + ": the header of the binary signal is truncated");
+    }
+    std::memcpy(&header, current, sizeof(Header));
+    current += sizeof(Header);
+    if (std::memcmp(header.magic, headerMagic, sizeof(header.magic)) != 0 || header.version != formatVersion) {
+      throw std::runtime_error(this->fileName + ": not a binary signal of version " + std::to_string(formatVersion));
+    }
+    if (header.valueType != ValueType::float32 && header.valueType != ValueType::float64) {
+      throw std::runtime_error(this->fileName + ": unknown value type " + std::to_string(int(header.valueType)));
+    }
+    if (header.layout != Layout::records && header.layout != Layout::columnBlocks) {
+      throw std::runtime_error(this->fileName + ": unknown layout " + std::to_string(int(header.layout)));
+    }
+    if (header.numOfVariables > maxNumOfVariables) {
+      throw std::runtime_error(this->fileName + ": too many signal variables " + std::to_string(header.numOfVariables));
+    }
+    valueSize = header.valueType == ValueType::float32 ? sizeof(float) : sizeof(double);
+  }
+
+  /*!
+    @copydoc SignalReader::next
+
+    The error message contains the index of the piece.
+   */
+  bool next(double &time, std::vector<double> &valuation) override {
+    const std::size_t numOfVariables = header.numOfVariables;
+    valuation.resize(numOfVariables);
+    if (header.layout == Layout::records) {
+      const std::size_t recordSize = (numOfVariables + 1) * valueSize;
+      if (!ensure(recordSize)) {
+        return truncated();
+      }
+      time = readValue(current);
+      for (std::size_t j = 0; j < numOfVariables; j++) {
+        valuation[j] = readValue(current + (j + 1) * valueSize);
+      }
+      current += recordSize;
+    } else {
+      if (indexInBlock == blockSize) {
+        // Move to the next block. The whole block is kept in [current, end) until it is consumed.
+        uint32_t size = 0;
+        while (size == 0) {
+          if (!ensure(sizeof(uint32_t))) {
+            return truncated();
+          }
+          std::memcpy(&size, current, sizeof(uint32_t));
+          current += sizeof(uint32_t);
+        }
+        const std::size_t pieceSize = (numOfVariables + 1) * valueSize;
+        if (size > std::numeric_limits<std::size_t>::max() / pieceSize) {
+          throw std::runtime_error(fileName + ": the block at piece " + std::to_string(numOfPieces) + " is too large");
+        }
+        if (!ensure(size * pieceSize)) {
+          throw std::runtime_error(fileName + ": the block at piece " + std::to_string(numOfPieces) + " is truncated");
+        }
+        blockSize = size;
+        indexInBlock = 0;
+      }
+      time = readValue(current + indexInBlock * valueSize);
+      for (std::size_t j = 0; j < numOfVariables; j++) {
+        valuation[j] = readValue(current + ((j + 1) * blockSize + indexInBlock) * valueSize);
+      }
+      indexInBlock++;
+      if (indexInBlock == blockSize) {
+        current += blockSize * (numOfVariables + 1) * valueSize;
+      }
+    }
+    numOfPieces++;
+    return true;
+  }
+
+  boost::optional<bool> isAbsTime() const override {
+    return bool(header.isAbsTime);
+  }
+
+private:
+  Header header;
+  std::size_t valueSize;
+  //! @brief The number of the pieces read so far
+  std::size_t numOfPieces = 0;
+  //! @brief The number of the pieces in the current block and the index of the next piece in it
+  std::size_t blockSize = 0;
+  std::size_t indexInBlock = 0;
+
+  double readValue(const char *p) const {
+    if (header.valueType == ValueType::float32) {
+      float v;
+      std::memcpy(&v, p, sizeof(float));
+      return v;
+    } else {
+      double v;
+      std::memcpy(&v, p, sizeof(double));
+      return v;
+    }
+  }
+
+  //! @brief Check if the file ends at the boundary of the pieces
+  bool truncated() {
+    if (current != end) {
+      throw std::runtime_error(fileName + ": the piece " + std::to_string(numOfPieces) + " is truncated");
+    }
+    return false;
+  }
+};
+
+//! @brief A piece of the signal passed between threads
+struct SignalPiece {
+  double time;
+  std::vector<double> valuation;
+};
+
+/*!
+  @brief Read the pieces by another reader in a background thread
+
+  The background thread reads, e.g., decompresses and parses, the pieces ahead into a ring buffer so that the reading overlaps with the matching.
+ */
+class PrefetchingSignalReader : public SignalReader {
+public:
+  /*!
+    @param [in] reader The reader used in the background thread
+    @param [in] capacity The maximum number of the pieces read ahead
+   */
+  explicit PrefetchingSignalReader(std::unique_ptr<SignalReader> reader, std::size_t capacity = 4096) :
+    SignalReader(reader->getFileName()), reader(std::move(reader)), pieces(capacity) {
+    producer = std::thread([this] {
+        SignalPiece piece;
+        try {
+          while (this->reader->next(piece.time, piece.valuation)) {
+            if (!pieces.push(piece)) {
+              // The consumer stopped
+              return;
+            }
+          }
+        } catch (...) {
+          error = std::current_exception();
+        }
+        pieces.close();
+      });
+  }
+
+  ~PrefetchingSignalReader() {
+    pieces.close();
+    producer.join();
+  }
+
+  /*!
+    @copydoc SignalReader::next
+
+    The error in the background thread is rethrown here after the pieces read before it.
+   */
+  bool next(double &time, std::vector<double> &valuation) override {
+    if (!pieces.pop(piece)) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+      return false;
+    }
+    time = piece.time;
+    std::swap(valuation, piece.valuation);
+    return true;
+  }
+
+  boost::optional<bool> isAbsTime() const override {
+    return reader->isAbsTime();
+  }
+
+private:
+  const std::unique_ptr<SignalReader> reader;
+  RingBuffer<SignalPiece> pieces;
+  //! @brief The latest piece taken. Its memory is given back to the ring buffer.
+  SignalPiece piece;
+  std::exception_ptr error;
+  std::thread producer;
+};
+
+/*!
+  @brief Detect the compression of the file by its magic number
+
+  @returns "gzip", "bzip2", "zstd", or the empty string if the file is not compressed or not a regular file
+ */
+static inline std::string detectCompression(FILE *file) {
+  struct stat st;
+  unsigned char magic[4] = {};
+  const int fd = fileno(file);
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || pread(fd, magic, sizeof(magic), 0) < 3) {
+    return "";
+  }
+  if (magic[0] == 0x1f && magic[1] == 0x8b) {
+    return "gzip";
+  } else if (magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h') {
+    return "bzip2";
+  } else if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+    return "zstd";
+  }
+  return "";
+}
+
+/*!
+  @brief The stream decompressing the file
+
+  @throws std::runtime_error If the compression is not supported by this build, i.e., zstd without the support in Boost.Iostreams
+ */
+static inline std::unique_ptr<std::istream> makeDecompressingStream(FILE *file, const std::string &fileName, const std::string &compression) {
+  auto stream = std::make_unique<boost::iostreams::filtering_istream>();
+  if (compression == "gzip") {
+    stream->push(boost::iostreams::gzip_decompressor());
+  } else if (compression == "bzip2") {
+    stream->push(boost::iostreams::bzip2_decompressor());
+  } else if (compression == "zstd") {
+#ifdef QTPM_HAVE_ZSTD
+    stream->push(boost::iostreams::zstd_decompressor());
+#else
+    throw std::runtime_error(fileName + ": zstd is not supported by this build");
+#endif
+  }
+  // The whole file is read as in the memory-mapped case
+  if (lseek(fileno(file), 0, SEEK_SET) < 0) {
+    throw std::runtime_error(fileName + ": " + std::strerror(errno));
+  }
+  stream->push(boost::iostreams::file_descriptor_source(fileno(file), boost::iostreams::never_close_handle));
+  // Report the error in the decompression by an exception
+  stream->exceptions(std::ios::badbit);
+  return std::move(stream);
+}
+
+//! @brief The names of the supported formats of the signal
+static inline bool isSignalFormatName(const std::string &format) {
+  return format == "text" || format == "binary";
+}
+
+/*!
+  @brief Make a reader of the signal in the given format
+
+  A file compressed by gzip, bzip2, or zstd is decompressed and parsed in a background thread.
+
+  @pre isSignalFormatName(format)
+  @throws std::runtime_error If the header of the binary signal is invalid or the compression is not supported
+ */
+static inline std::unique_ptr<SignalReader> makeSignalReader(FILE *file, const std::string &fileName, const std::string &format) {
+  const std::string compression = detectCompression(file);
+  std::unique_ptr<std::istream> source;
+  if (!compression.empty()) {
+    source = makeDecompressingStream(file, fileName, compression);
+  }
+  std::unique_ptr<SignalReader> reader;
+  if (format == "binary") {
+    reader = std::make_unique<BinarySignalReader>(file, fileName, std::move(source));
+  } else {
+    reader = std::make_unique<TextSignalReader>(file, fileName, std::move(source));
+  }
+  if (!compression.empty()) {
+    return std::make_unique<PrefetchingSignalReader>(std::move(reader));
+  }
+  return reader;
+}
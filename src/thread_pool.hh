@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/*!
+  @brief A fixed-size pool of worker threads
+
+  The tasks are executed in the order of submission by the first idle worker.
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(std::size_t numOfThreads) {
+    workers.reserve(numOfThreads);
+    for (std::size_t i = 0; i < numOfThreads; i++) {
+      workers.emplace_back([this] {
+          while (true) {
+            std::function<void()> task;
+            {
+              std::unique_lock<std::mutex> lock(mutex);
+              cond.wait(lock, [this] { return stopped || !tasks.empty(); });
+              if (tasks.empty()) {
+                return;
+              }
+              task = std::move(tasks.front());
+              tasks.pop();
+            }
+            task();
+          }
+        });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
+    }
+    cond.notify_all();
+    for (auto &worker: workers) {
+      worker.join();
+    }
+  }
+
+  /*!
+    @brief Submit a task to the pool
+    @returns The future to wait for the task. The exception thrown in the task is rethrown by its get().
+   */
+  template<class F>
+  std::future<void> submit(F &&f) {
+    auto task = std::make_shared<std::packaged_task<void()>>(std::forward<F>(f));
+    std::future<void> future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace([task] { (*task)(); });
+    }
+    cond.notify_one();
+    return future;
+  }
+
+  std::size_t size() const {
+    return workers.size();
+  }
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool stopped = false;
+};
@@ -31,6 +31,7 @@ namespace boost{
   enum graph_init_states_t {graph_init_states};
   enum graph_num_of_vars_t {graph_num_of_vars};
   enum graph_max_constraints_t {graph_max_constraints};
+  enum graph_derive_t {graph_derive};
 
   BOOST_INSTALL_PROPERTY(vertex, match);
   BOOST_INSTALL_PROPERTY(edge, reset);
@@ -38,6 +39,7 @@ namespace boost{
   BOOST_INSTALL_PROPERTY(graph, init_states);
   BOOST_INSTALL_PROPERTY(graph, num_of_vars);
   BOOST_INSTALL_PROPERTY(graph, max_constraints);
+  BOOST_INSTALL_PROPERTY(graph, derive);
 }
 
 template<class ClockVariables>
@@ -259,7 +261,9 @@ struct BoostTATransition {
 template<class SignalVariables, class ClockVariables>
 using BoostTimedAutomaton = boost::adjacency_list<boost::listS, boost::vecS, boost::directedS, BoostTAState<SignalVariables>, BoostTATransition<ClockVariables>, 
                                                   boost::property<boost::graph_num_of_vars_t, std::size_t,
-                                                                  boost::property<boost::graph_max_constraints_t, std::size_t>>>;
+                                                                  boost::property<boost::graph_max_constraints_t, std::size_t,
+                                                                                  // The derived signal variables given by the graph attribute "derive" (see derived_signal.hh)
+                                                                                  boost::property<boost::graph_derive_t, std::string>>>>;
 
 template<class SignalVariables, class ClockVariables>
 static inline 
@@ -273,6 +277,7 @@ void parseBoostTA(std::istream &file, BoostTimedAutomaton<SignalVariables, Clock
   dp.property("label", boost::get(&BoostTAState<SignalVariables>::label, BoostTA));
   dp.property("reset", boost::get(&BoostTATransition<ClockVariables>::resetVars, BoostTA));
   dp.property("guard", boost::get(&BoostTATransition<ClockVariables>::guard, BoostTA));
+  dp.property("derive", boost::ref_property_map<BoostTimedAutomaton<SignalVariables, ClockVariables>*, std::string>(boost::get_property(BoostTA, boost::graph_derive)));
 
   boost::read_graphviz(file, BoostTA, dp, "id");
 
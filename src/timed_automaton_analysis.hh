@@ -0,0 +1,201 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <boost/optional.hpp>
+
+#include "timed_automaton.hh"
+
+//! @brief If each clock variable is reset by some transition of the timed automaton
+template<class SignalVariables, class ClockVariables>
+static inline std::vector<bool>
+resetClockVariables(const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA) {
+  const std::size_t numOfClockVariables = boost::get_property(TA, boost::graph_num_of_vars);
+  std::vector<bool> isReset(numOfClockVariables, false);
+  for (auto range = boost::edges(TA); range.first != range.second; range.first++) {
+    for (const auto x: TA[*range.first].resetVars.resetVars) {
+      if (x < numOfClockVariables) {
+        isReset[x] = true;
+      }
+    }
+  }
+  return isReset;
+}
+
+//! @brief The upper bound of the duration from the beginning of the matching imposed by the guard, i.e., the minimum upper bound on the clock variables never reset
+template<class ClockVariables>
+static inline boost::optional<double>
+guardDurationBound(const std::vector<Constraint<ClockVariables>> &guard, const std::vector<bool> &isReset) {
+  boost::optional<double> bound;
+  for (const auto &g: guard) {
+    if (!isReset[g.x] && (g.odr == Constraint<ClockVariables>::Order::lt || g.odr == Constraint<ClockVariables>::Order::le)) {
+      bound = bound ? std::min<double>(*bound, g.c) : g.c;
+    }
+  }
+  return bound;
+}
+
+/*!
+  @brief An upper bound of the duration of any matching of the timed automaton
+
+  Since all the clock variables are zero at the beginning of a matching, a clock variable never reset in the timed automaton shows the duration from the beginning of the matching. Therefore, if every transition to an accepting state has an upper bound @f$x < c@f$ or @f$x \leq c@f$ on such a clock variable @f$x@f$, the duration of any matching is at most the maximum of such @f$c@f$.
+
+  @returns The upper bound of the duration of the matching. If we cannot bound it, boost::none is returned.
+ */
+template<class SignalVariables, class ClockVariables>
+static inline boost::optional<double>
+maxMatchDuration(const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA,
+                 const std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> &initStates) {
+  // A matching of duration zero at an initial state is not bounded by the transitions
+  if (std::any_of(initStates.begin(), initStates.end(), [&](auto q) { return TA[q].isMatch; })) {
+    return boost::none;
+  }
+
+  const std::vector<bool> isReset = resetClockVariables(TA);
+
+  double maxDuration = 0;
+  for (auto range = boost::edges(TA); range.first != range.second; range.first++) {
+    if (!TA[boost::target(*range.first, TA)].isMatch) {
+      continue;
+    }
+    const boost::optional<double> bound = guardDurationBound(TA[*range.first].guard, isReset);
+    if (!bound) {
+      return boost::none;
+    }
+    maxDuration = std::max(maxDuration, *bound);
+  }
+
+  return maxDuration;
+}
+
+/*!
+  @brief An upper bound of the duration from the beginning of the matching at each state such that an accepting state is still reachable
+
+  Since the duration only increases along a run, the duration at a state is bounded by the guard of every transition taken later (see @ref maxMatchDuration). The bound of a state is the maximum over the runs from the state to an accepting state of the minimum bound of the guards on the run. We compute it by a fixed point iteration, similarly to the widest path problem.
+
+  @returns The bound of each state. It is infinity if we cannot bound it and negative infinity if no accepting state is reachable. A configuration at a state whose duration exceeds the bound never reaches an accepting state.
+ */
+template<class SignalVariables, class ClockVariables>
+static inline std::vector<double>
+maxFeasibleDurations(const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA) {
+  const std::vector<bool> isReset = resetClockVariables(TA);
+  std::vector<double> maxDurations(boost::num_vertices(TA), -std::numeric_limits<double>::infinity());
+
+  // The bound changes only finitely many times because it is one of the constants in the guards or infinity
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto range = boost::edges(TA); range.first != range.second; range.first++) {
+      const auto source = boost::source(*range.first, TA);
+      const auto target = boost::target(*range.first, TA);
+      const boost::optional<double> bound = guardDurationBound(TA[*range.first].guard, isReset);
+      double duration = bound ? *bound : std::numeric_limits<double>::infinity();
+      if (!TA[target].isMatch) {
+        duration = std::min(duration, maxDurations[target]);
+      }
+      if (duration > maxDurations[source]) {
+        maxDurations[source] = duration;
+        changed = true;
+      }
+    }
+  }
+
+  return maxDurations;
+}
+
+/*!
+  @brief The clock variables live at each state by a backward fixed point iteration
+
+  A clock variable is live at a state if some run from the state reads it in a guard before resetting it. This is shared by @ref activeClockVariables and preprocessing::renumberClockVariables, which represent the transitions differently.
+
+  @param [in] forEachTransition Calls its argument visit(source, target, guard, resetVars) for each transition
+  @returns The liveness of each clock variable at each state. A clock variable out of numOfClockVariables is ignored.
+ */
+template<class ForEachTransition>
+static inline std::vector<std::vector<bool>>
+liveClockVariables(std::size_t numOfStates, std::size_t numOfClockVariables, ForEachTransition forEachTransition) {
+  std::vector<std::vector<bool>> isLive(numOfStates, std::vector<bool>(numOfClockVariables, false));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    forEachTransition([&](std::size_t source, std::size_t target, const auto &guard, const auto &resetVars) {
+        std::vector<bool> &live = isLive[source];
+        const auto setLive = [&](std::size_t x) {
+          if (x < numOfClockVariables && !live[x]) {
+            live[x] = true;
+            changed = true;
+          }
+        };
+        for (const auto &constraint: guard) {
+          setLive(constraint.x);
+        }
+        for (std::size_t x = 0; x < numOfClockVariables; x++) {
+          if (isLive[target][x] && std::find(resetVars.begin(), resetVars.end(), x) == resetVars.end()) {
+            setLive(x);
+          }
+        }
+      });
+  }
+  return isLive;
+}
+
+/*!
+  @brief The clock variables active at each state
+
+  A clock variable is active at a state if it is live there (see @ref liveClockVariables). The value of an inactive clock variable never affects the matching, so it can be released when we enter the state.
+
+  @returns The activeness of each clock variable at each state
+ */
+template<class SignalVariables, class ClockVariables>
+static inline std::vector<std::vector<bool>>
+activeClockVariables(const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA) {
+  return liveClockVariables(boost::num_vertices(TA), boost::get_property(TA, boost::graph_num_of_vars), [&TA](const auto &visit) {
+      for (auto range = boost::edges(TA); range.first != range.second; range.first++) {
+        visit(boost::source(*range.first, TA), boost::target(*range.first, TA), TA[*range.first].guard, TA[*range.first].resetVars.resetVars);
+      }
+    });
+}
+
+/*!
+  @brief A fingerprint of the states, the transitions, the guards, the resets, and the labels of the timed automaton
+
+  This is the FNV-1a hash over the structure in the order of the vertices and their out-edges, which is stable across runs on the same platform. It is used to check that a checkpoint is restored to the same automaton as the one it was written with.
+ */
+template<class SignalVariables, class ClockVariables>
+static inline uint64_t
+automatonFingerprint(const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA) {
+  uint64_t hash = 14695981039346656037ULL;
+  const auto combine = [&hash](int64_t value) {
+    for (std::size_t i = 0; i < sizeof(value); i++) {
+      hash = (hash ^ ((uint64_t(value) >> (8 * i)) & 0xff)) * 1099511628211ULL;
+    }
+  };
+  const auto combineConstraints = [&combine](const auto &constraints) {
+    combine(constraints.size());
+    for (const auto &constraint: constraints) {
+      combine(constraint.x);
+      combine(int64_t(constraint.odr));
+      combine(constraint.c);
+    }
+  };
+  combine(boost::num_vertices(TA));
+  combine(boost::get_property(TA, boost::graph_num_of_vars));
+  for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+    const auto &state = TA[*range.first];
+    combine(state.isInit);
+    combine(state.isMatch);
+    combineConstraints(state.label);
+    combine(boost::out_degree(*range.first, TA));
+    for (auto edgeRange = boost::out_edges(*range.first, TA); edgeRange.first != edgeRange.second; edgeRange.first++) {
+      const auto &transition = TA[*edgeRange.first];
+      combine(boost::target(*edgeRange.first, TA));
+      combineConstraints(transition.guard);
+      combine(transition.resetVars.resetVars.size());
+      for (const auto x: transition.resetVars.resetVars) {
+        combine(x);
+      }
+    }
+  }
+  return hash;
+}
@@ -0,0 +1,430 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include "timed_automaton.hh"
+#include "timed_automaton_analysis.hh"
+
+//! @brief What @ref preprocessBoostTA removed from a timed automaton
+struct PreprocessingReport {
+  std::size_t numOfStatesBefore = 0;
+  std::size_t numOfStatesAfter = 0;
+  //! @brief The states not reachable from any initial state
+  std::size_t numOfUnreachableStates = 0;
+  //! @brief The reachable states from which no accepting state is reachable
+  std::size_t numOfUselessStates = 0;
+  //! @brief The states merged into an equivalent state
+  std::size_t numOfMergedStates = 0;
+  std::size_t numOfTransitionsBefore = 0;
+  std::size_t numOfTransitionsAfter = 0;
+  //! @brief The transitions whose guard is unsatisfiable
+  std::size_t numOfUnsatisfiableTransitions = 0;
+  std::size_t numOfClockVariablesBefore = 0;
+  std::size_t numOfClockVariablesAfter = 0;
+};
+
+namespace preprocessing {
+  template<class ClockVariables>
+  struct Transition {
+    std::size_t source;
+    std::size_t target;
+    std::vector<Constraint<ClockVariables>> guard;
+    std::vector<ClockVariables> resetVars;
+  };
+
+  //! @brief A constraint as a comparable tuple
+  template<class Variables>
+  static inline std::tuple<int, int, int> toTuple(const Constraint<Variables> &constraint) {
+    return std::make_tuple(int(constraint.x), int(constraint.odr), constraint.c);
+  }
+
+  //! @brief The guard as a sorted set of the constraints, which is independent of the order of the constraints
+  template<class ClockVariables>
+  static inline std::vector<std::tuple<int, int, int>> normalizeGuard(const std::vector<Constraint<ClockVariables>> &guard) {
+    std::vector<std::tuple<int, int, int>> result;
+    result.reserve(guard.size());
+    for (const auto &constraint: guard) {
+      result.push_back(toTuple(constraint));
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  }
+
+  template<class ClockVariables>
+  static inline std::vector<ClockVariables> normalizeResets(std::vector<ClockVariables> resetVars) {
+    std::sort(resetVars.begin(), resetVars.end());
+    resetVars.erase(std::unique(resetVars.begin(), resetVars.end()), resetVars.end());
+    return resetVars;
+  }
+
+  //! @brief Check if some non-negative clock valuation satisfies the guard
+  template<class ClockVariables>
+  static inline bool isSatisfiable(const std::vector<Constraint<ClockVariables>> &guard) {
+    using Order = typename Constraint<ClockVariables>::Order;
+    // The lower and upper bounds of each clock variable with their closedness
+    std::map<ClockVariables, std::pair<std::pair<int, bool>, std::pair<int, bool>>> bounds;
+    for (const auto &constraint: guard) {
+      auto it = bounds.find(constraint.x);
+      if (it == bounds.end()) {
+        it = bounds.emplace(constraint.x, std::make_pair(std::make_pair(0, true), std::make_pair(std::numeric_limits<int>::max(), true))).first;
+      }
+      auto &lower = it->second.first;
+      auto &upper = it->second.second;
+      switch (constraint.odr) {
+      case Order::lt:
+      case Order::le: {
+        const auto bound = std::make_pair(constraint.c, constraint.odr == Order::le);
+        // The tighter one is smaller, and the open one is tighter for the same constant
+        if (bound.first < upper.first || (bound.first == upper.first && !bound.second)) {
+          upper = bound;
+        }
+        break;
+      }
+      case Order::gt:
+      case Order::ge: {
+        const auto bound = std::make_pair(constraint.c, constraint.odr == Order::ge);
+        if (bound.first > lower.first || (bound.first == lower.first && !bound.second)) {
+          lower = bound;
+        }
+        break;
+      }
+      }
+    }
+    return std::all_of(bounds.begin(), bounds.end(), [](const auto &bound) {
+        const auto &lower = bound.second.first;
+        const auto &upper = bound.second.second;
+        return lower.first < upper.first || (lower.first == upper.first && lower.second && upper.second);
+      });
+  }
+
+  /*!
+    @brief Keep only the states reachable from an initial state and reaching an accepting state
+   */
+  template<class SignalVariables, class ClockVariables>
+  static inline void trim(std::vector<BoostTAState<SignalVariables>> &states, std::vector<Transition<ClockVariables>> &transitions,
+                                       PreprocessingReport &report) {
+    const std::size_t size = states.size();
+    std::vector<std::vector<std::size_t>> successors(size), predecessors(size);
+    for (const auto &transition: transitions) {
+      successors[transition.source].push_back(transition.target);
+      predecessors[transition.target].push_back(transition.source);
+    }
+    const auto search = [&](std::vector<bool> &visited, const std::vector<std::vector<std::size_t>> &next) {
+      std::queue<std::size_t> queue;
+      for (std::size_t q = 0; q < size; q++) {
+        if (visited[q]) {
+          queue.push(q);
+        }
+      }
+      while (!queue.empty()) {
+        const std::size_t q = queue.front();
+        queue.pop();
+        for (const std::size_t to: next[q]) {
+          if (!visited[to]) {
+            visited[to] = true;
+            queue.push(to);
+          }
+        }
+      }
+    };
+    std::vector<bool> isReachable(size);
+    std::vector<bool> isUseful(size);
+    for (std::size_t q = 0; q < size; q++) {
+      isReachable[q] = states[q].isInit;
+      isUseful[q] = states[q].isMatch;
+    }
+    search(isReachable, successors);
+    search(isUseful, predecessors);
+
+    std::vector<long> newIndex(size, -1);
+    std::vector<BoostTAState<SignalVariables>> newStates;
+    for (std::size_t q = 0; q < size; q++) {
+      if (!isReachable[q]) {
+        report.numOfUnreachableStates++;
+      } else if (!isUseful[q]) {
+        report.numOfUselessStates++;
+      } else {
+        newIndex[q] = newStates.size();
+        newStates.push_back(std::move(states[q]));
+      }
+    }
+    states = std::move(newStates);
+    transitions.erase(std::remove_if(transitions.begin(), transitions.end(), [&](const auto &transition) {
+          return newIndex[transition.source] < 0 || newIndex[transition.target] < 0;
+        }), transitions.end());
+    for (auto &transition: transitions) {
+      transition.source = newIndex[transition.source];
+      transition.target = newIndex[transition.target];
+    }
+  }
+
+  /*!
+    @brief Renumber the clock variables to share an index whenever possible
+
+    A clock variable is live at a state if it may appear in a guard before it is reset (see @ref liveClockVariables). First, the resets of a clock variable not live at the target are removed. Then, the clock variables reset by exactly the same transitions always have the same value, and they are replaced with one of them. Finally, the clock variables never live at the same state share an index, which we assign by a greedy coloring. The clock variables never reset keep their own index so that they still show the duration from the beginning of the matching (see @ref maxMatchDuration).
+
+    @returns The number of the clock variables after renumbering
+   */
+  template<class ClockVariables>
+  static inline std::size_t renumberClockVariables(std::size_t numOfStates, std::vector<Transition<ClockVariables>> &transitions,
+                                                   std::size_t numOfClockVariables) {
+    for (const auto &transition: transitions) {
+      for (const auto x: transition.resetVars) {
+        numOfClockVariables = std::max<std::size_t>(numOfClockVariables, x + 1);
+      }
+    }
+    const auto rename = [&](const std::vector<std::size_t> &index) {
+      for (auto &transition: transitions) {
+        for (auto &constraint: transition.guard) {
+          constraint.x = index[constraint.x];
+        }
+        for (auto &x: transition.resetVars) {
+          x = index[x];
+        }
+        transition.resetVars = normalizeResets(std::move(transition.resetVars));
+      }
+    };
+    const auto liveness = [&] {
+      return liveClockVariables(numOfStates, numOfClockVariables, [&transitions](const auto &visit) {
+          for (const auto &transition: transitions) {
+            visit(transition.source, transition.target, transition.guard, transition.resetVars);
+          }
+        });
+    };
+
+    std::vector<std::size_t> identity(numOfClockVariables);
+    std::iota(identity.begin(), identity.end(), 0);
+    rename(identity);
+    std::vector<std::vector<bool>> isLive = liveness();
+    for (auto &transition: transitions) {
+      transition.resetVars.erase(std::remove_if(transition.resetVars.begin(), transition.resetVars.end(), [&](ClockVariables x) {
+            return !isLive[transition.target][x];
+          }), transition.resetVars.end());
+    }
+
+    // The transitions resetting each clock variable
+    std::vector<std::vector<std::size_t>> resetBy(numOfClockVariables);
+    for (std::size_t i = 0; i < transitions.size(); i++) {
+      for (const auto x: transitions[i].resetVars) {
+        resetBy[x].push_back(i);
+      }
+    }
+    std::vector<std::size_t> representative(numOfClockVariables);
+    std::map<std::vector<std::size_t>, std::size_t> toRepresentative;
+    for (std::size_t x = 0; x < numOfClockVariables; x++) {
+      representative[x] = toRepresentative.emplace(resetBy[x], x).first->second;
+    }
+    rename(representative);
+    isLive = liveness();
+
+    std::vector<bool> isUsed(numOfClockVariables, false);
+    std::vector<std::vector<bool>> interfere(numOfClockVariables, std::vector<bool>(numOfClockVariables, false));
+    for (const auto &live: isLive) {
+      for (std::size_t x = 0; x < numOfClockVariables; x++) {
+        for (std::size_t y = 0; live[x] && y < numOfClockVariables; y++) {
+          interfere[x][y] = interfere[x][y] || live[y];
+        }
+        isUsed[x] = isUsed[x] || live[x];
+      }
+    }
+    std::vector<bool> isReset(numOfClockVariables, false);
+    for (const auto &transition: transitions) {
+      for (const auto x: transition.resetVars) {
+        isReset[x] = true;
+      }
+    }
+
+    // Greedy coloring of the used clock variables
+    std::vector<std::size_t> color(numOfClockVariables, 0);
+    std::vector<bool> isNeverResetColor;
+    for (std::size_t x = 0; x < numOfClockVariables; x++) {
+      if (!isUsed[x]) {
+        continue;
+      }
+      std::size_t c = 0;
+      const auto isAvailable = [&](std::size_t c) {
+        if (isNeverResetColor[c] || !isReset[x]) {
+          return false;
+        }
+        for (std::size_t y = 0; y < x; y++) {
+          if (isUsed[y] && color[y] == c && interfere[x][y]) {
+            return false;
+          }
+        }
+        return true;
+      };
+      while (c < isNeverResetColor.size() && !isAvailable(c)) {
+        c++;
+      }
+      if (c == isNeverResetColor.size()) {
+        isNeverResetColor.push_back(!isReset[x]);
+      }
+      color[x] = c;
+    }
+    rename(color);
+    return isNeverResetColor.size();
+  }
+
+  /*!
+    @brief Merge the bisimilar states
+
+    Two states are bisimilar if they have the same acceptance and label, and the same transitions up to the bisimilarity of the targets. We compute the coarsest bisimulation by partition refinement. Since the sum of every semiring we use is idempotent, the weight of a matching is the same.
+   */
+  template<class SignalVariables, class ClockVariables>
+  static inline void mergeBisimilarStates(std::vector<BoostTAState<SignalVariables>> &states, std::vector<Transition<ClockVariables>> &transitions,
+                                          PreprocessingReport &report) {
+    using Move = std::tuple<std::vector<std::tuple<int, int, int>>, std::vector<ClockVariables>, std::size_t>;
+    const std::size_t size = states.size();
+    std::vector<std::size_t> block(size);
+    std::size_t numOfBlocks;
+    {
+      std::map<std::pair<bool, std::vector<std::tuple<int, int, int>>>, std::size_t> toBlock;
+      for (std::size_t q = 0; q < size; q++) {
+        std::vector<std::tuple<int, int, int>> label;
+        for (const auto &constraint: states[q].label) {
+          label.push_back(toTuple(constraint));
+        }
+        block[q] = toBlock.emplace(std::make_pair(states[q].isMatch, std::move(label)), toBlock.size()).first->second;
+      }
+      numOfBlocks = toBlock.size();
+    }
+    while (true) {
+      std::vector<std::vector<Move>> moves(size);
+      for (const auto &transition: transitions) {
+        moves[transition.source].emplace_back(normalizeGuard(transition.guard), normalizeResets(transition.resetVars), block[transition.target]);
+      }
+      std::map<std::pair<std::size_t, std::vector<Move>>, std::size_t> toBlock;
+      std::vector<std::size_t> newBlock(size);
+      for (std::size_t q = 0; q < size; q++) {
+        std::sort(moves[q].begin(), moves[q].end());
+        moves[q].erase(std::unique(moves[q].begin(), moves[q].end()), moves[q].end());
+        newBlock[q] = toBlock.emplace(std::make_pair(block[q], std::move(moves[q])), toBlock.size()).first->second;
+      }
+      // A refinement never merges blocks, so the partition is stable if the number of the blocks does not change
+      block = std::move(newBlock);
+      if (toBlock.size() == numOfBlocks) {
+        break;
+      }
+      numOfBlocks = toBlock.size();
+    }
+
+    // The first state of each block represents it
+    std::vector<long> representative(numOfBlocks, -1);
+    std::vector<BoostTAState<SignalVariables>> newStates;
+    std::vector<std::size_t> newIndex(numOfBlocks);
+    for (std::size_t q = 0; q < size; q++) {
+      if (representative[block[q]] < 0) {
+        representative[block[q]] = q;
+        newIndex[block[q]] = newStates.size();
+        newStates.push_back(states[q]);
+      } else {
+        report.numOfMergedStates++;
+        newStates[newIndex[block[q]]].isInit = newStates[newIndex[block[q]]].isInit || states[q].isInit;
+      }
+    }
+    std::vector<Transition<ClockVariables>> newTransitions;
+    std::vector<std::vector<Move>> addedMoves(numOfBlocks);
+    for (auto &transition: transitions) {
+      if (representative[block[transition.source]] != long(transition.source)) {
+        continue;
+      }
+      // Remove the transitions made duplicate by the merging
+      Move move(normalizeGuard(transition.guard), normalizeResets(transition.resetVars), block[transition.target]);
+      auto &added = addedMoves[block[transition.source]];
+      if (std::find(added.begin(), added.end(), move) != added.end()) {
+        continue;
+      }
+      added.push_back(std::move(move));
+      transition.source = newIndex[block[transition.source]];
+      transition.target = newIndex[block[transition.target]];
+      newTransitions.push_back(std::move(transition));
+    }
+    states = std::move(newStates);
+    transitions = std::move(newTransitions);
+  }
+}
+
+/*!
+  @brief Simplify a timed automaton without changing the result of the matching
+
+  The following are applied in this order.
+  1. The transitions with an unsatisfiable guard are removed.
+  2. The states not reachable from an initial state or not reaching an accepting state are removed.
+  3. The clock variables are renumbered to the minimum number of the indices (see preprocessing::renumberClockVariables).
+  4. The bisimilar states are merged (see preprocessing::mergeBisimilarStates).
+
+  The attribute "derive" is kept and num_of_vars and max_constraints are updated. The matching can be only different in the partition of the zones.
+
+  @param [in,out] TA The timed automaton
+  @param [in,out] initStates The initial states of TA
+  @returns What is removed
+ */
+template<class SignalVariables, class ClockVariables>
+static inline PreprocessingReport
+preprocessBoostTA(BoostTimedAutomaton<SignalVariables, ClockVariables> &TA,
+                  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> &initStates) {
+  using namespace preprocessing;
+  using Automaton = BoostTimedAutomaton<SignalVariables, ClockVariables>;
+  PreprocessingReport report;
+  report.numOfStatesBefore = boost::num_vertices(TA);
+  report.numOfTransitionsBefore = boost::num_edges(TA);
+  report.numOfClockVariablesBefore = boost::get_property(TA, boost::graph_num_of_vars);
+
+  std::vector<BoostTAState<SignalVariables>> states;
+  std::vector<Transition<ClockVariables>> transitions;
+  for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+    states.push_back(TA[*range.first]);
+    // The initial states are given by initStates
+    states.back().isInit = std::find(initStates.begin(), initStates.end(), *range.first) != initStates.end();
+  }
+  for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+    for (auto edges = boost::out_edges(*range.first, TA); edges.first != edges.second; edges.first++) {
+      const auto &transition = TA[*edges.first];
+      if (!isSatisfiable(transition.guard)) {
+        report.numOfUnsatisfiableTransitions++;
+        continue;
+      }
+      transitions.push_back({boost::source(*edges.first, TA), boost::target(*edges.first, TA), transition.guard, transition.resetVars.resetVars});
+    }
+  }
+
+  trim(states, transitions, report);
+  const std::size_t numOfClockVariables = renumberClockVariables(states.size(), transitions, report.numOfClockVariablesBefore);
+  mergeBisimilarStates(states, transitions, report);
+
+  Automaton result(states.size());
+  std::vector<typename Automaton::vertex_descriptor> resultInitStates;
+  std::size_t max_constraints = 0;
+  for (std::size_t q = 0; q < states.size(); q++) {
+    result[q] = std::move(states[q]);
+    if (result[q].isInit) {
+      resultInitStates.push_back(q);
+    }
+  }
+  for (auto &transition: transitions) {
+    for (const auto &constraint: transition.guard) {
+      max_constraints = std::max<std::size_t>(max_constraints, constraint.c);
+    }
+    BoostTATransition<ClockVariables> edge;
+    edge.guard = std::move(transition.guard);
+    edge.resetVars.resetVars = std::move(transition.resetVars);
+    boost::add_edge(transition.source, transition.target, std::move(edge), result);
+  }
+  boost::set_property(result, boost::graph_num_of_vars, numOfClockVariables);
+  boost::set_property(result, boost::graph_max_constraints, max_constraints);
+  boost::set_property(result, boost::graph_derive, boost::get_property(TA, boost::graph_derive));
+
+  report.numOfStatesAfter = boost::num_vertices(result);
+  report.numOfTransitionsAfter = boost::num_edges(result);
+  report.numOfClockVariablesAfter = numOfClockVariables;
+  TA = std::move(result);
+  initStates = std::move(resultInitStates);
+  return report;
+}
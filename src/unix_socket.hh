@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+//! @brief The address of the Unix domain socket at the path
+static inline sockaddr_un unixSocketAddress(const std::string &path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error(path + ": the path of a Unix domain socket must be shorter than " + std::to_string(sizeof(address.sun_path)) + " bytes");
+  }
+  std::memcpy(address.sun_path, path.data(), path.size());
+  return address;
+}
+
+/*!
+  @brief Listen on the Unix domain socket at the path
+
+  A stale socket left at the path, e.g., by a killed daemon, is removed. A socket someone listens on and any other file at the path are not removed.
+
+  @returns The file descriptor of the listening socket
+  @throws std::runtime_error If the socket cannot be made, e.g., another daemon listens on the path
+ */
+static inline int listenUnixSocket(const std::string &path, int backlog = 64) {
+  const sockaddr_un address = unixSocketAddress(path);
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+    // Only a socket refusing the connection is stale
+    const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+      throw std::runtime_error(path + ": " + std::strerror(errno));
+    }
+    const int error = connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0 ? 0 : errno;
+    close(probe);
+    if (error == 0) {
+      throw std::runtime_error(path + ": the socket is in use");
+    }
+    if (error != ECONNREFUSED) {
+      throw std::runtime_error(path + ": " + std::strerror(error));
+    }
+    unlink(path.c_str());
+  }
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw std::runtime_error(path + ": " + std::strerror(errno));
+  }
+  if (bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, backlog) != 0) {
+    const int error = errno;
+    close(fd);
+    throw std::runtime_error(path + ": " + std::strerror(error));
+  }
+  return fd;
+}
+
+/*!
+  @brief Connect to the Unix domain socket at the path
+
+  @returns The file descriptor of the connected socket
+  @throws std::runtime_error If the socket cannot be connected
+ */
+static inline int connectUnixSocket(const std::string &path) {
+  const sockaddr_un address = unixSocketAddress(path);
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    throw std::runtime_error(path + ": " + std::strerror(errno));
+  }
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+    const int error = errno;
+    close(fd);
+    throw std::runtime_error(path + ": " + std::strerror(error));
+  }
+  return fd;
+}
+
+/*!
+  @brief Write all the bytes to the connected socket, waiting while the peer does not read them
+
+  A peer closed before the write does not raise SIGPIPE, which would terminate the process.
+  @returns false if the peer is closed or an error occurs
+ */
+static inline bool writeAll(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    const ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
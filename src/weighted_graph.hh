@@ -2,6 +2,18 @@
 
 #include <boost/graph/adjacency_list.hpp>
 
+/*!
+  @brief The traits of the semirings
+
+  - is_idempotent: \f$a + a = a\f$ holds for any \f$a\f$. For such a semiring, \f$a \preceq b \iff a + b = b\f$ is a partial order compatible with the operations.
+  - is_monotone: the semiring is idempotent and \f$a \times b \preceq a\f$ holds for any \f$a\f$ and \f$b\f$, i.e., the weight of a run never improves when it is extended.
+ */
+template<typename Weight>
+struct semiring_traits {
+  static constexpr bool is_idempotent = false;
+  static constexpr bool is_monotone = false;
+};
+
 template<typename Weight>
 using WeightedGraph = boost::adjacency_list<boost::listS, boost::listS, boost::directedS, boost::no_property, boost::property<boost::edge_weight_t, Weight>>;
 
@@ -20,7 +32,7 @@ public:
     return MinPlusSemiring( data + x.data);
   }
   void operator*=(const MinPlusSemiring& x) {
-    data += x;
+    data += x.data;
   }
   bool operator!=(const MinPlusSemiring& x) const {
     return data != x.data;
@@ -54,6 +66,12 @@ std::size_t hash_value(MinPlusSemiring<Base> const& v) {
   return boost::hash_value(v.data);
 }
 
+template<typename Base>
+struct semiring_traits<MinPlusSemiring<Base>> {
+  static constexpr bool is_idempotent = true;
+  static constexpr bool is_monotone = false;
+};
+
 template<typename Base>
 class MaxPlusSemiring {
 public:
@@ -69,7 +87,7 @@ public:
     return MaxPlusSemiring{data + x.data};
   }
   void operator*=(const MaxPlusSemiring& x) {
-    data += x;
+    data += x.data;
   }
   bool operator!=(const MaxPlusSemiring& x) const {
     return data != x.data;
@@ -103,6 +121,12 @@ std::size_t hash_value(MaxPlusSemiring<Base> const& v) {
   return boost::hash_value(v.data);
 }
 
+template<typename Base>
+struct semiring_traits<MaxPlusSemiring<Base>> {
+  static constexpr bool is_idempotent = true;
+  static constexpr bool is_monotone = false;
+};
+
 template<typename Base>
 class MaxMinSemiring {
 public:
@@ -154,6 +178,12 @@ std::size_t hash_value(MaxMinSemiring<Base> const& v) {
   return boost::hash_value(v.data);
 }
 
+template<typename Base>
+struct semiring_traits<MaxMinSemiring<Base>> {
+  static constexpr bool is_idempotent = true;
+  static constexpr bool is_monotone = true;
+};
+
 class BooleanSemiring {
 public:
   bool data;
@@ -197,3 +227,9 @@ public:
 static inline std::size_t hash_value(BooleanSemiring const& v) {
   return boost::hash_value(v.data);
 }
+
+template<>
+struct semiring_traits<BooleanSemiring> {
+  static constexpr bool is_idempotent = true;
+  static constexpr bool is_monotone = true;
+};
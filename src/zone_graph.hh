@@ -9,6 +9,7 @@
 #include "dbm.hh"
 #include "constraint.hh"
 #include "timed_automaton.hh"
+#include "piece_store.hh"
 
 
 template<class SignalVariables, class ClockVariables, class Value>
@@ -19,14 +20,14 @@ struct BoostZoneGraphState {
    * @brief The flag showing if one can fire a (discrete) transition. This is used to forbid having multiple jumps at the same time
    * @note In the current implementation, this flag is unnecessary because we have the following:
    *   @code{.cpp} 
-   *     jumpable == !(valuations.empty())
+   *     jumpable == !(history.empty())
    *   @endcode
    */
   bool jumpable;
   //! @brief The corresponding zone
   DBM zone;
-  //! @brief The signal valuations observed after the latest (discrete) transition
-  std::vector<std::vector<Value>> valuations;
+  //! @brief The pieces of the signal observed after the latest (discrete) transition
+  PieceRange history;
 };
 
 //! The type of the vertices must be listS because we might remove them.
@@ -118,6 +119,19 @@ void zoneConstruction(const BoostTimedAutomaton<SignalVariables, ClockVariables>
 }
 
 
+/*!
+  @brief Release the clock variables inactive at a state
+  @param [in,out] zone The zone when we enter the state
+  @param [in] isActive The activeness of each clock variable at the state (see @ref activeClockVariables)
+*/
+static inline void releaseInactiveClockVariables(DBM &zone, const std::vector<bool> &isActive) {
+  for (std::size_t x = 0; x < isActive.size(); x++) {
+    if (!isActive[x]) {
+      zone.release(x);
+    }
+  }
+}
+
 /*!
   @brief Zone construction with an additional clock variable.
   @tparam SignalVariables 
@@ -127,30 +141,37 @@ void zoneConstruction(const BoostTimedAutomaton<SignalVariables, ClockVariables>
   @param [in] TA A timed automaton.
   @param [in] initConfTA Initial configuarion of the timed automaton
   @param [in] cost A cost function.
-  @param [in] valuation A data valuation
+  @param [in] pieces The pieces of the signal referred to by the histories. The last one is the current piece.
   @param [in] duartion A length of the signal
   @param [out] ZG The zone graph with weight.
   @param [out] initStatesZG The initial states of the zone graph.
+  @param [in] prune A predicate on the weight of the discrete transitions. If it holds, the transition is not added. This is used to prune the runs that are known to be useless from the weight of one transition.
+  @param [in] activeClocks The activeness of each clock variable at each state of the TA (see @ref activeClockVariables). The inactive clock variables are released when we enter a state so that the zones different only in them are merged. If it is empty, no clock variable is released.
+  @param [in] stateCost If it is given, the weight of staying at a state of the TA is computed by this function from the state instead of cost from its label, e.g., to look up a precomputed table (see @ref LabelRobustnessTable). The result must be the same as cost.
 */
 template<class SignalVariables, class ClockVariables, class Weight, class Value>
 void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVariables> &TA,
                            const std::vector<std::pair<BoostZoneGraphState<SignalVariables, ClockVariables, Value>, Weight>> &initConfTA,
-                           const std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> &cost,
-                           const std::vector<Value> &valuation,
+                           const std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> &cost,
+                           const PieceStore<Value> &pieces,
                            const double duration,
                            BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value> &ZG,
-                           std::unordered_map<typename BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>::vertex_descriptor,Weight> &initStatesZG) {
+                           std::unordered_map<typename BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>::vertex_descriptor,Weight> &initStatesZG,
+                           const std::function<bool(const Weight &)> &prune = nullptr,
+                           const std::vector<std::vector<bool>> &activeClocks = {},
+                           const std::function<Weight(typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor, const PieceHistory<Value> &)> &stateCost = nullptr) {
   using TA_t = BoostTimedAutomaton<SignalVariables, ClockVariables>;
   using ZG_t = BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>;
   using TAState = typename TA_t::vertex_descriptor;
-  boost::unordered_map<std::tuple<typename TA_t::vertex_descriptor, bool, DBM::Tuple, std::vector<std::vector<Value>>>, typename ZG_t::vertex_descriptor> toZGState;
+  boost::unordered_map<std::tuple<typename TA_t::vertex_descriptor, bool, DBM::Tuple, PieceRange>, typename ZG_t::vertex_descriptor> toZGState;
+  const std::size_t currentPiece = pieces.getEnd() - 1;
   // const double max_constraints = std::max<double>(ceil(duration), boost::get_property(TA, boost::graph_max_constraints));
 #ifdef DEBUG
   const auto num_of_vars = boost::get_property(TA, boost::graph_num_of_vars);
 #endif
 
-  const auto convToKey = [] (BoostZoneGraphState<SignalVariables, ClockVariables, Value> x) {
-                           return std::make_tuple(x.vertex, x.jumpable, x.zone.toTuple(), x.valuations);
+  const auto convToKey = [] (const BoostZoneGraphState<SignalVariables, ClockVariables, Value> &x) {
+                           return std::make_tuple(x.vertex, x.jumpable, x.zone.toTuple(), x.history);
                          };
   const auto dwellTimeClockVar = initConfTA.front().first.zone.getNumOfVar() - 1;
 
@@ -176,8 +197,18 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
     toZGState[convToKey(ZG[v])] = v;
   }
 
-  const auto addEdge = [&toZGState,&ZG,&nextConf,&TA,&cost,&convToKey] (const auto currentZGState, const auto nextTAState, const bool jumpable, const DBM &zone, const std::vector<std::vector<Value>> &nextValuations) -> bool {
-                         auto zgState = toZGState.find(std::make_tuple(nextTAState, jumpable, zone.toTuple(), nextValuations));
+  // The vertices removed in the current iteration
+  std::unordered_set<typename BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>::vertex_descriptor> removedVertices;
+
+  const auto addEdge = [&toZGState,&ZG,&nextConf,&TA,&cost,&stateCost,&pieces,&convToKey,&removedVertices,&prune] (const auto currentZGState, const auto nextTAState, const bool jumpable, const DBM &zone, const PieceRange nextHistory) -> bool {
+                         const PieceHistory<Value> history(pieces, ZG[currentZGState].history);
+                         const Weight weight = jumpable ? Weight::one() :
+                           stateCost ? stateCost(ZG[currentZGState].vertex, history) :
+                           cost(TA[ZG[currentZGState].vertex].label, history);
+                         if (prune && prune(weight)) {
+                           return false;
+                         }
+                         auto zgState = toZGState.find(std::make_tuple(nextTAState, jumpable, zone.toTuple(), nextHistory));
                          typename ZG_t::edge_descriptor edge;
 
                          const bool isNew = zgState == toZGState.end();
@@ -189,10 +220,12 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
                          } else {
                            // targetStateInZA is new
                            auto nextZGState = boost::add_vertex(ZG);
+                           // The descriptor of a removed vertex may be reused for the new vertex
+                           removedVertices.erase(nextZGState);
                            ZG[nextZGState].vertex = nextTAState;
                            ZG[nextZGState].jumpable = jumpable;
                            ZG[nextZGState].zone = zone;
-                           ZG[nextZGState].valuations = nextValuations;
+                           ZG[nextZGState].history = nextHistory;
                            toZGState[convToKey(ZG[nextZGState])] = nextZGState;
                            edge = std::get<0>(boost::add_edge(currentZGState, nextZGState, ZG));
                            if (!jumpable) {
@@ -203,16 +236,22 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
 #endif
                          }
 
-                         if (!jumpable) {
-                           boost::put(boost::edge_weight, ZG, edge, cost(TA[ZG[currentZGState].vertex].label,
-                                                                         ZG[currentZGState].valuations));
-                         } else {
-                           boost::put(boost::edge_weight, ZG, edge, Weight::one());
-                         }
+                         boost::put(boost::edge_weight, ZG, edge, weight);
 
                          return isNew;
                        };
 
+  // Remove a useless vertex. Another vertex may have the same key, e.g., the initial configurations with different weights, and we keep it.
+  const auto removeVertex = [&toZGState,&ZG,&initStatesZG,&convToKey,&removedVertices] (const auto zgState) {
+    const auto it = toZGState.find(convToKey(ZG[zgState]));
+    if (it != toZGState.end() && it->second == zgState) {
+      toZGState.erase(it);
+    }
+    initStatesZG.erase(zgState);
+    clear_vertex(zgState, ZG);
+    remove_vertex(zgState, ZG);
+    removedVertices.insert(zgState);
+  };
 
   while (!nextConf.empty()) {
 #ifdef DEBUG
@@ -221,7 +260,7 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
 #endif
     auto currentConf = std::move(nextConf);
     nextConf.clear();
-    std::unordered_set<typename decltype(currentConf)::value_type> removedVertices;
+    removedVertices.clear();
 
     for (const auto &currentZGState : currentConf) {
       // OPTIMIZATION: This find is unnecessary if currentConf is std::list (I can remove an element during its iteration)
@@ -243,7 +282,7 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
       nowZone.tighten(dwellTimeClockVar, -1, {duration, true});
 
       const auto listDiscreteTransitions =
-        [&TA,&taState] (const DBM& nowZone, std::vector<std::pair<TAState, DBM>> &v) {
+        [&TA,&taState,&activeClocks] (const DBM& nowZone, std::vector<std::pair<TAState, DBM>> &v) {
           // discrete transition
           for (auto range = boost::out_edges(taState, TA); range.first != range.second; range.first++) {
             const auto edge = *range.first;
@@ -269,6 +308,9 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
               for (auto x : TA[edge].resetVars.resetVars) {
                 nextZone.reset(x);
               }
+              if (!activeClocks.empty()) {
+                releaseInactiveClockVariables(nextZone, activeClocks[nextTAState]);
+              }
 
               v.emplace_back(nextTAState, nextZone);
             }
@@ -285,17 +327,10 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
           auto futureZone = nowZone;
           futureZone.elapse();
           std::vector<std::pair<TAState, DBM>> futureTAStates;
-          listDiscreteTransitions(nowZone, futureTAStates);
+          listDiscreteTransitions(futureZone, futureTAStates);
           // If there is no transition in the future, the current state is useless and we remove it.
           if (futureTAStates.empty()) {
-            const auto nextZGStateP = toZGState.find(convToKey(ZG[currentZGState]));
-            if (nextZGStateP != toZGState.end()) {
-              initStatesZG.erase(nextZGStateP->second);
-              clear_vertex(nextZGStateP->second, ZG);
-              remove_vertex(nextZGStateP->second, ZG);
-              removedVertices.insert(nextZGStateP->second);
-              toZGState.erase(nextZGStateP);
-            }
+            removeVertex(currentZGState);
 #ifdef DEBUG
     assert(std::none_of(initStatesZG.begin(), initStatesZG.end(), [&](auto p) {
           return TA[ZG[p.first].vertex].isMatch;
@@ -313,9 +348,7 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
 
       } else {
         // continuous transition
-        auto nextValuations = ZG[currentZGState].valuations;
-
-        nextValuations.push_back(valuation);
+        const PieceRange nextHistory = ZG[currentZGState].history.extendedTo(currentPiece);
         nowZone.elapse();
         nowZone.tighten(dwellTimeClockVar, -1, {duration, true});
         if (!nowZone.isSatisfiableWithoutCanonize()) {
@@ -324,12 +357,12 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
 
         std::vector<std::pair<TAState, DBM>> nextTAStates;
         listDiscreteTransitions(nowZone, nextTAStates);
-        // We add the state only if it has a next state
+        // We add the state only if it has a next state now or later
 
         if (!nextTAStates.empty()) {
-          bool isNew = addEdge(currentZGState, ZG[currentZGState].vertex, true, nowZone, nextValuations);
+          bool isNew = addEdge(currentZGState, ZG[currentZGState].vertex, true, nowZone, nextHistory);
           if (isNew) {
-            const auto nextZGStateP = toZGState.find(std::make_tuple(ZG[currentZGState].vertex, true, nowZone.toTuple(), nextValuations));
+            const auto nextZGStateP = toZGState.find(std::make_tuple(ZG[currentZGState].vertex, true, nowZone.toTuple(), nextHistory));
             for (auto &p: nextTAStates) {
               addEdge(nextZGStateP->second, std::move(p.first), false, std::move(p.second), {});
             }
@@ -343,18 +376,13 @@ void zoneConstructionWithT(const BoostTimedAutomaton<SignalVariables, ClockVaria
           auto futureZone = nowZone;
           futureZone.elapse();
           std::vector<std::pair<TAState, DBM>> futureTAStates;
-          listDiscreteTransitions(nowZone, futureTAStates);
+          listDiscreteTransitions(futureZone, futureTAStates);
           // If there is no transition in the future, the current state is useless and we remove it.
           if (futureTAStates.empty()) {
-            const auto nextZGStateP = toZGState.find(convToKey(ZG[currentZGState]));
-            // If we cannot go out and the state already exists, we remove the state.
-            if (nextZGStateP != toZGState.end()) {
-              initStatesZG.erase(nextZGStateP->second);
-              clear_vertex(nextZGStateP->second, ZG);
-              remove_vertex(nextZGStateP->second, ZG);
-              removedVertices.insert(nextZGStateP->second);
-              toZGState.erase(nextZGStateP);
-            }
+            removeVertex(currentZGState);
+          } else {
+            // The run stays in the state until a later piece
+            addEdge(currentZGState, ZG[currentZGState].vertex, true, nowZone, nextHistory);
           }
         }
 
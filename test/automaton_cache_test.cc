@@ -0,0 +1,137 @@
+#include <cstddef>
+#include <cstring>
+#include <boost/test/unit_test.hpp>
+#include "../src/automaton_cache.hh"
+
+BOOST_AUTO_TEST_SUITE(AutomatonCacheTest)
+
+using SignalVariables = uint8_t;
+using ClockVariables = uint8_t;
+using TimedAutomaton = BoostTimedAutomaton<SignalVariables, ClockVariables>;
+
+static void checkSameConstraints(const std::vector<Constraint<uint8_t>> &expected, const std::vector<Constraint<uint8_t>> &actual) {
+  BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+  for (std::size_t i = 0; i < expected.size(); i++) {
+    BOOST_CHECK_EQUAL(expected[i].x, actual[i].x);
+    BOOST_CHECK(expected[i].odr == actual[i].odr);
+    BOOST_CHECK_EQUAL(expected[i].c, actual[i].c);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( roundTripTest )
+{
+  char directory[] = "/tmp/qtpm-automaton-XXXXXX";
+  BOOST_REQUIRE(mkdtemp(directory));
+  const std::string fileName = std::string(directory) + "/velocity.dot.qtpmc";
+  for (const std::string dotFileName: {"../test/phi7.dot", "../test/velocity.dot", "../test/timed_automaton.dot"}) {
+    TimedAutomaton expected;
+    std::vector<TimedAutomaton::vertex_descriptor> expectedInitStates;
+    std::ifstream file(dotFileName);
+    parseBoostTA(file, expected, expectedInitStates);
+    boost::set_property(expected, boost::graph_derive, std::string("diff(x0,10)"));
+    writeAutomatonCache(fileName, expected);
+
+    TimedAutomaton TA;
+    std::vector<TimedAutomaton::vertex_descriptor> initStates;
+    BOOST_REQUIRE(loadAutomatonCache(fileName, TA, initStates));
+    BOOST_CHECK(initStates == expectedInitStates);
+    BOOST_CHECK_EQUAL(boost::get_property(TA, boost::graph_num_of_vars), boost::get_property(expected, boost::graph_num_of_vars));
+    BOOST_CHECK_EQUAL(boost::get_property(TA, boost::graph_max_constraints), boost::get_property(expected, boost::graph_max_constraints));
+    BOOST_CHECK_EQUAL(boost::get_property(TA, boost::graph_derive), "diff(x0,10)");
+    BOOST_REQUIRE_EQUAL(boost::num_vertices(TA), boost::num_vertices(expected));
+    BOOST_REQUIRE_EQUAL(boost::num_edges(TA), boost::num_edges(expected));
+    for (std::size_t q = 0; q < boost::num_vertices(TA); q++) {
+      BOOST_CHECK_EQUAL(TA[q].isInit, expected[q].isInit);
+      BOOST_CHECK_EQUAL(TA[q].isMatch, expected[q].isMatch);
+      checkSameConstraints(expected[q].label, TA[q].label);
+      // The out-edges are in the same order
+      auto edges = boost::out_edges(q, TA);
+      auto expectedEdges = boost::out_edges(q, expected);
+      for (; edges.first != edges.second && expectedEdges.first != expectedEdges.second; edges.first++, expectedEdges.first++) {
+        BOOST_CHECK_EQUAL(boost::target(*edges.first, TA), boost::target(*expectedEdges.first, expected));
+        BOOST_CHECK(TA[*edges.first].resetVars.resetVars == expected[*expectedEdges.first].resetVars.resetVars);
+        checkSameConstraints(expected[*expectedEdges.first].guard, TA[*edges.first].guard);
+      }
+      BOOST_CHECK(edges.first == edges.second && expectedEdges.first == expectedEdges.second);
+    }
+  }
+  unlink(fileName.c_str());
+  rmdir(directory);
+}
+
+BOOST_AUTO_TEST_CASE( invalidImageTest )
+{
+  char directory[] = "/tmp/qtpm-automaton-XXXXXX";
+  BOOST_REQUIRE(mkdtemp(directory));
+  const std::string dotFileName = std::string(directory) + "/phi7.dot";
+  {
+    std::ifstream source("../test/phi7.dot");
+    std::ofstream destination(dotFileName);
+    destination << source.rdbuf();
+  }
+  TimedAutomaton expected;
+  std::vector<TimedAutomaton::vertex_descriptor> expectedInitStates;
+  loadBoostTA(dotFileName, expected, expectedInitStates);
+  const std::string fileName = automatonCacheFileName(dotFileName);
+  writeAutomatonCache(fileName, expected);
+  BOOST_CHECK(isAutomatonCache(fileName));
+  BOOST_CHECK(!isAutomatonCache(dotFileName));
+  BOOST_CHECK(isAutomatonCacheFresh(fileName, dotFileName));
+
+  // A truncated image and an image of another version are rejected
+  std::string image;
+  {
+    std::ifstream is(fileName, std::ios::binary);
+    image.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+  }
+  TimedAutomaton TA;
+  std::vector<TimedAutomaton::vertex_descriptor> initStates;
+  std::ofstream(fileName, std::ios::binary) << image.substr(0, image.size() - 1);
+  BOOST_CHECK(!loadAutomatonCache(fileName, TA, initStates));
+  BOOST_CHECK_THROW(loadBoostTA(fileName, TA, initStates), std::runtime_error);
+  image[8]++;
+  std::ofstream(fileName, std::ios::binary) << image;
+  BOOST_CHECK(!loadAutomatonCache(fileName, TA, initStates));
+  BOOST_CHECK_EQUAL(boost::num_vertices(TA), 0);
+  image[8]--;
+
+  // A guard or a reset out of the clock variables and an unknown order are rejected
+  AutomatonCache::Header header;
+  std::memcpy(&header, image.data(), sizeof(header));
+  BOOST_REQUIRE_GT(header.numOfVars, 0);
+  const std::size_t constraintsOffset = sizeof(header) + header.numOfStates * sizeof(AutomatonCache::StateRecord) +
+    header.numOfEdges * sizeof(AutomatonCache::EdgeRecord);
+  const auto writeModified = [&](std::size_t offset, std::uint64_t value, std::size_t size) {
+    std::string modified = image;
+    std::memcpy(&modified[offset], &value, size);
+    std::ofstream(fileName, std::ios::binary) << modified;
+  };
+  writeModified(offsetof(AutomatonCache::Header, numOfVars), 0, sizeof(header.numOfVars));
+  BOOST_CHECK(!loadAutomatonCache(fileName, TA, initStates));
+  BOOST_CHECK_THROW(loadBoostTA(fileName, TA, initStates), std::runtime_error);
+  writeModified(constraintsOffset + offsetof(AutomatonCache::ConstraintRecord, odr), 4, sizeof(std::uint32_t));
+  BOOST_CHECK(!loadAutomatonCache(fileName, TA, initStates));
+  writeModified(constraintsOffset + header.numOfConstraints * sizeof(AutomatonCache::ConstraintRecord), header.numOfVars, sizeof(std::uint32_t));
+  BOOST_CHECK(!loadAutomatonCache(fileName, TA, initStates));
+  BOOST_CHECK_EQUAL(boost::num_vertices(TA), 0);
+  std::ofstream(fileName, std::ios::binary) << image;
+  {
+    TimedAutomaton loaded;
+    std::vector<TimedAutomaton::vertex_descriptor> loadedInitStates;
+    BOOST_CHECK(loadAutomatonCache(fileName, loaded, loadedInitStates));
+  }
+
+  // The stale or invalid image next to the .dot file is ignored
+  image[8]++;
+  std::ofstream(fileName, std::ios::binary) << image;
+  loadBoostTA(dotFileName, TA, initStates);
+  BOOST_CHECK_EQUAL(boost::num_vertices(TA), boost::num_vertices(expected));
+  BOOST_CHECK(initStates == expectedInitStates);
+  BOOST_CHECK_THROW(loadBoostTA(dotFileName + ".missing", TA, initStates), std::runtime_error);
+
+  unlink(fileName.c_str());
+  unlink(dotFileName.c_str());
+  rmdir(directory);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -30,6 +30,27 @@ BOOST_AUTO_TEST_CASE( ReleaseTest )
   BOOST_TEST(!released.isSatisfiable());  
 }
 
+BOOST_AUTO_TEST_CASE( ReleaseCanonicalTest )
+{
+  // Two zones different only in y are the same after releasing y
+  DBM A = DBM::zero(3), B;
+  A.release(0);
+  A.release(1);
+  A.tighten(0, -1, {3, true});
+  A.tighten(-1, 1, {-1, true});
+  A.tighten(1, 0, {2, false});
+  B = A;
+  B.tighten(1, -1, {2, true});
+
+  A.release(1);
+  B.release(1);
+  BOOST_TEST(A.isCanonized());
+  BOOST_TEST((A == B));
+  // x is not changed
+  BOOST_CHECK_EQUAL(A.value(1, 0).first, 3);
+  BOOST_CHECK_EQUAL(A.value(0, 1).first, 0);
+}
+
 BOOST_AUTO_TEST_CASE( InclusionTest )
 {
   DBM A, B;
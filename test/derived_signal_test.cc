@@ -0,0 +1,122 @@
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <sstream>
+#include "../src/derived_signal.hh"
+#include "../src/timed_automaton.hh"
+
+BOOST_AUTO_TEST_SUITE(DerivedSignalTest)
+
+BOOST_AUTO_TEST_CASE( parseDerivationTest )
+{
+  const auto difference = parseDerivation("diff(x0,10)");
+  BOOST_REQUIRE(difference);
+  BOOST_CHECK(difference->kind == Derivation::Kind::difference);
+  BOOST_CHECK_EQUAL(difference->variable, 0);
+  BOOST_CHECK_EQUAL(difference->window, 10);
+  const auto mean = parseDerivation("mean(x12,2.5)");
+  BOOST_REQUIRE(mean);
+  BOOST_CHECK(mean->kind == Derivation::Kind::mean);
+  BOOST_CHECK_EQUAL(mean->variable, 12);
+  BOOST_CHECK_EQUAL(mean->window, 2.5);
+
+  BOOST_CHECK(!parseDerivation("sum(x0,10)"));
+  BOOST_CHECK(!parseDerivation("diff(y0,10)"));
+  BOOST_CHECK(!parseDerivation("diff(x0,-1)"));
+  BOOST_CHECK(!parseDerivation("diff(x0,10"));
+  BOOST_CHECK(!parseDerivation("diff(x,10)"));
+
+  const auto derivations = parseDerivations(" diff(x0,10); max(x3,5)  ");
+  BOOST_REQUIRE_EQUAL(derivations.size(), 2);
+  BOOST_CHECK(derivations[1].kind == Derivation::Kind::max);
+  BOOST_CHECK_THROW(parseDerivations("diff(x0,10) foo"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( slidingWindowTest )
+{
+  // Compare with the naive computation over all the pieces
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<double> durationDist(0, 2);
+  std::uniform_int_distribution<int> valueDist(-10, 10);
+  std::vector<double> begins, ends, values;
+  double time = 0;
+  for (int i = 0; i < 300; i++) {
+    begins.push_back(time);
+    // Some pieces end exactly at the beginning of the window
+    time += i % 3 == 0 ? 1 : durationDist(engine);
+    ends.push_back(time);
+    values.push_back(valueDist(engine));
+  }
+
+  for (const double window: {0.0, 1.0, 3.0, 10.0}) {
+    SlidingWindow difference(Derivation::Kind::difference, window);
+    SlidingWindow mean(Derivation::Kind::mean, window);
+    SlidingWindow min(Derivation::Kind::min, window);
+    SlidingWindow max(Derivation::Kind::max, window);
+    for (std::size_t i = 0; i < values.size(); i++) {
+      const double windowBegin = ends[i] - window;
+      std::size_t first = 0;
+      while (ends[first] < windowBegin) {
+        first++;
+      }
+      BOOST_CHECK_EQUAL(difference.push(begins[i], ends[i], values[i]), values[i] - values[first]);
+
+      double expectedMin = values[i], expectedMax = values[i], integral = 0;
+      for (std::size_t j = 0; j <= i; j++) {
+        if (ends[j] > windowBegin) {
+          expectedMin = std::min(expectedMin, values[j]);
+          expectedMax = std::max(expectedMax, values[j]);
+          integral += values[j] * (ends[j] - std::max(begins[j], windowBegin));
+        }
+      }
+      BOOST_CHECK_EQUAL(min.push(begins[i], ends[i], values[i]), expectedMin);
+      BOOST_CHECK_EQUAL(max.push(begins[i], ends[i], values[i]), expectedMax);
+      const double length = ends[i] - std::max(0.0, windowBegin);
+      const double expectedMean = length > 0 ? integral / length : values[i];
+      BOOST_CHECK_CLOSE(mean.push(begins[i], ends[i], values[i]) + 100, expectedMean + 100, 1e-9);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( derivedSignalReaderTest )
+{
+  // The absolute time mode
+  const std::string content = "10 1 5\n20 4 5\n30 2 5\n40 8 5\n";
+  FILE *file = tmpfile();
+  fwrite(content.data(), 1, content.size(), file);
+  fflush(file);
+  // The second derivation refers to the first one
+  DerivedSignalReader reader(makeSignalReader(file, "signal.txt", "text"), parseDerivations("diff(x0,10) max(x2,20)"), true);
+  std::vector<std::vector<double>> expected = {{1, 5, 0, 0}, {4, 5, 3, 3}, {2, 5, -2, 3}, {8, 5, 6, 6}};
+  double time;
+  std::vector<double> valuation;
+  for (const auto &row: expected) {
+    BOOST_REQUIRE(reader.next(time, valuation));
+    BOOST_CHECK_EQUAL_COLLECTIONS(valuation.begin(), valuation.end(), row.begin(), row.end());
+  }
+  BOOST_CHECK(!reader.next(time, valuation));
+  fclose(file);
+
+  // An undefined variable
+  file = tmpfile();
+  fwrite(content.data(), 1, content.size(), file);
+  fflush(file);
+  DerivedSignalReader undefined(makeSignalReader(file, "signal.txt", "text"), parseDerivations("diff(x5,10)"), true);
+  BOOST_CHECK_THROW(undefined.next(time, valuation), std::runtime_error);
+  fclose(file);
+}
+
+BOOST_AUTO_TEST_CASE( deriveAttributeTest )
+{
+  BoostTimedAutomaton<uint8_t, uint8_t> TA;
+  std::vector<typename BoostTimedAutomaton<uint8_t, uint8_t>::vertex_descriptor> initStates;
+  std::istringstream stream("digraph G {\n"
+                            "  derive=\"diff(x0,10)\";\n"
+                            "  rise [label=\"{x2 > 10}\"][init=1][match=1];\n"
+                            "}\n");
+  parseBoostTA(stream, TA, initStates);
+  const auto derivations = parseDerivations(boost::get_property(TA, boost::graph_derive));
+  BOOST_REQUIRE_EQUAL(derivations.size(), 1);
+  BOOST_CHECK(derivations.front() == *parseDerivation("diff(x0,10)"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,39 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+
+#include "../src/label_robustness.hh"
+#include "../src/robustness.hh"
+#include "../src/weighted_graph.hh"
+
+BOOST_AUTO_TEST_SUITE(LabelRobustnessTableTest)
+
+using SignalVariables = uint8_t;
+using ClockVariables = uint8_t;
+
+typedef boost::mpl::list<MinPlusSemiring<double>, MaxPlusSemiring<double>, MaxMinSemiring<double>, BooleanSemiring> testTypes;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(evaluateTest, Weight, testTypes)
+{
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../test/small3.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  parseBoostTA(file, TA, initStates);
+
+  LabelRobustnessTable<Weight, double, SignalVariables> table(TA);
+  // {x0 > 100, x1 < 30}, {x0 > 100}, and the empty label
+  BOOST_CHECK_EQUAL(table.getNumOfLabels(), 3);
+
+  const std::vector<std::vector<double>> valuations = {{130, 20}, {90, 40}, {100, 30}, {150, -10}};
+  const std::vector<double> x0 = {130, 90, 100, 150};
+  const std::vector<double> x1 = {20, 40, 30, -10};
+  table.evaluate(valuations.size(), {x0.data(), x1.data()});
+
+  for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+    for (std::size_t i = 0; i < valuations.size(); i++) {
+      BOOST_CHECK_EQUAL(table.at(table.labelOf(*range.first), i).data,
+                        singleSpaceRobustness<Weight>(TA[*range.first].label, valuations[i]).data);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
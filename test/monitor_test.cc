@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+#include "../src/monitor.hh"
+
+BOOST_AUTO_TEST_SUITE(MonitorTest)
+
+using SignalVariables = uint8_t;
+using ClockVariables = uint8_t;
+using Value = double;
+
+//! @brief Feed the signal to the monitor and return the printed result
+static std::string runMonitor(Monitor<SignalVariables, ClockVariables, Value> &monitor,
+                              const std::vector<std::vector<Value>> &valuations,
+                              const std::vector<double> &durations) {
+  char *buffer = nullptr;
+  std::size_t size = 0;
+  FILE *out = open_memstream(&buffer, &size);
+  monitor.setOutput(out);
+  for (std::size_t i = 0; i < valuations.size(); i++) {
+    monitor.feed(valuations[i], durations[i]);
+    monitor.printResult();
+  }
+  monitor.flushResult();
+  fclose(out);
+  std::string result(buffer, size);
+  free(buffer);
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE( makeMonitorTest )
+{
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../example/paper.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  parseBoostTA(file, TA, initStates);
+  const MonitorOptions options = {false, false, false, boost::none};
+
+  BOOST_CHECK((!makeMonitor<SignalVariables, ClockVariables, Value>("unknown", TA, initStates, options, stdout)));
+  BOOST_CHECK(isSemiringName("minplus"));
+  BOOST_CHECK(!isMonotoneSemiring("minplus"));
+  BOOST_CHECK(isMonotoneSemiring("boolean"));
+
+  const std::vector<std::vector<Value>> valuations = {{110, 10}, {140, 40}, {180, 60}, {130, 20}};
+  const std::vector<double> durations = {2.5, 1.0, 3.0, 2.0};
+
+  // The monitors on the same automaton are independent of each other
+  auto untagged = makeMonitor<SignalVariables, ClockVariables, Value>("maxmin", TA, initStates, options, stdout);
+  auto tagged = makeMonitor<SignalVariables, ClockVariables, Value>("maxmin", TA, initStates, options, stdout, "paper");
+  const std::string untaggedResult = runMonitor(*untagged, valuations, durations);
+  const std::string taggedResult = runMonitor(*tagged, valuations, durations);
+  BOOST_CHECK(!untaggedResult.empty());
+  BOOST_CHECK_EQUAL(untagged->getAbsTime(), 8.5);
+  BOOST_CHECK_GT(untagged->getPeakNumOfConfigurations(), 0);
+  BOOST_CHECK_GE(untagged->getPeakNumOfConfigurations(), untagged->getNumOfConfigurations());
+
+  // The tagged monitor prints the same results, each preceded by the tag
+  const std::string header = "----- Automaton: paper -----\n";
+  std::string stripped = taggedResult;
+  for (auto pos = stripped.find(header); pos != std::string::npos; pos = stripped.find(header, pos)) {
+    stripped.erase(pos, header.size());
+  }
+  BOOST_CHECK_EQUAL(taggedResult.compare(0, header.size(), header), 0);
+  BOOST_CHECK_EQUAL(stripped.size(), untaggedResult.size());
+}
+
+//! @brief Feed the signal to the monitor by blocks of blockSize pieces and return the printed result line by line in the lexicographic order
+static std::vector<std::string> runMonitorByBlocks(Monitor<SignalVariables, ClockVariables, Value> &monitor,
+                                                   const std::vector<std::vector<Value>> &columns,
+                                                   const std::vector<double> &durations, std::size_t blockSize) {
+  char *buffer = nullptr;
+  std::size_t size = 0;
+  FILE *out = open_memstream(&buffer, &size);
+  monitor.setOutput(out);
+  for (std::size_t begin = 0; begin < durations.size(); begin += blockSize) {
+    std::vector<const Value*> columnPointers;
+    for (const auto &column: columns) {
+      columnPointers.push_back(column.data() + begin);
+    }
+    monitor.feedBatch(std::min(blockSize, durations.size() - begin), durations.data() + begin, columnPointers);
+    monitor.printResult();
+  }
+  monitor.flushResult();
+  fclose(out);
+  std::vector<std::string> lines;
+  std::istringstream stream(std::string(buffer, size));
+  free(buffer);
+  for (std::string line; std::getline(stream, line);) {
+    lines.push_back(line);
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+BOOST_AUTO_TEST_CASE( coalesceAcrossBlocksTest )
+{
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../experiments/ringing.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  parseBoostTA(file, TA, initStates);
+  MonitorOptions options = {false, false, false, boost::none};
+  options.resultFormat = ResultFormat::csv;
+
+  // The truth values change every 4 pieces
+  std::vector<std::vector<Value>> columns(4, std::vector<Value>(24, 0));
+  std::vector<double> durations(24, 0.5);
+  for (std::size_t i = 0; i < durations.size(); i++) {
+    columns[3][i] = (i / 4) % 2 ? -11.0 - i : 11.0 + i;
+  }
+
+  // A matching starts in a run with x3 > 10 and ends in a later run with x3 < -10, including the last run
+  const std::vector<std::string> expected = {
+    ",1,0,0,1,2,0,10,0,12,1,8,0,12,1",
+    ",1,0,0,1,2,0,2,0,4,1,0,0,4,1",
+    ",1,0,0,1,2,0,6,0,8,1,4,0,8,1",
+    ",1,0,4,1,6,0,10,0,12,1,4,0,8,1",
+    ",1,0,4,1,6,0,6,0,8,1,0,0,4,1",
+    ",1,0,8,1,10,0,10,0,12,1,0,0,4,1",
+  };
+
+  // The runs are merged across the blocks of one piece as in one block
+  auto online = makeMonitor<SignalVariables, ClockVariables, Value>("boolean", TA, initStates, options, stdout);
+  auto offline = makeMonitor<SignalVariables, ClockVariables, Value>("boolean", TA, initStates, options, stdout);
+  const auto onlineResult = runMonitorByBlocks(*online, columns, durations, 1);
+  BOOST_CHECK_EQUAL_COLLECTIONS(onlineResult.begin(), onlineResult.end(), expected.begin(), expected.end());
+  const auto offlineResult = runMonitorByBlocks(*offline, columns, durations, durations.size());
+  BOOST_CHECK_EQUAL_COLLECTIONS(offlineResult.begin(), offlineResult.end(), expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL(online->getAbsTime(), 12);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+#include <boost/test/unit_test.hpp>
+#include "../src/piece_coalescer.hh"
+
+BOOST_AUTO_TEST_SUITE(PieceCoalescerTest)
+
+using SignalVariables = uint8_t;
+using ClockVariables = uint8_t;
+using Value = double;
+
+BOOST_AUTO_TEST_CASE( coalesceTest )
+{
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../experiments/ringing.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  parseBoostTA(file, TA, initStates);
+
+  BooleanPieceCoalescer<SignalVariables, Value> coalescer(TA);
+  // x3 > 10 and x3 < -10
+  BOOST_CHECK_EQUAL(coalescer.getNumOfAtoms(), 2);
+
+  // x3 is above 10, between -10 and 10, and below -10
+  const std::vector<Value> zeros(7, 0);
+  const std::vector<Value> x3 = {11, 20, 0, 5, -11, -30, 12};
+  const std::vector<double> durations = {1, 2, 3, 4, 5, 6, 7};
+  const std::vector<const Value*> columns = {zeros.data(), zeros.data(), zeros.data(), x3.data()};
+  std::vector<double> mergedDurations;
+  std::vector<std::vector<Value>> mergedColumns;
+  const std::size_t mergedSize = coalescer.coalesce(durations.size(), durations.data(), columns, mergedDurations, mergedColumns);
+
+  // The last run is pending until the end of the signal
+  BOOST_REQUIRE_EQUAL(mergedSize, 3);
+  const std::vector<double> expectedDurations = {3, 7, 11, 7};
+  const std::vector<Value> expectedX3 = {11, 0, -11, 12};
+  BOOST_CHECK_EQUAL_COLLECTIONS(mergedDurations.begin(), mergedDurations.begin() + mergedSize,
+                                expectedDurations.begin(), expectedDurations.begin() + 3);
+  BOOST_CHECK_EQUAL_COLLECTIONS(mergedColumns[3].begin(), mergedColumns[3].begin() + mergedSize,
+                                expectedX3.begin(), expectedX3.begin() + 3);
+  BOOST_CHECK_EQUAL(coalescer.getPendingWidth(), 4);
+  BOOST_CHECK_EQUAL(coalescer.getPendingDuration(), 7);
+  BOOST_REQUIRE_EQUAL(coalescer.flush(mergedDurations, mergedColumns), 1);
+  BOOST_CHECK_EQUAL(mergedDurations[0], 7);
+  BOOST_CHECK_EQUAL(mergedColumns[3][0], 12);
+  BOOST_CHECK_EQUAL(coalescer.flush(mergedDurations, mergedColumns), 0);
+  BOOST_CHECK_EQUAL(coalescer.getPendingWidth(), 0);
+
+  // The same by rows
+  std::vector<std::vector<Value>> valuations, mergedValuations;
+  for (const Value v: x3) {
+    valuations.push_back({0, 0, 0, v});
+  }
+  coalescer.coalesce(valuations, durations, mergedValuations, mergedDurations);
+  BOOST_REQUIRE_EQUAL(mergedValuations.size(), 4);
+  BOOST_CHECK_EQUAL_COLLECTIONS(mergedDurations.begin(), mergedDurations.end(),
+                                expectedDurations.begin(), expectedDurations.end());
+  BOOST_CHECK_EQUAL(mergedValuations[2][3], -11);
+}
+
+BOOST_AUTO_TEST_CASE( coalesceAcrossBlocksTest )
+{
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../experiments/ringing.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  parseBoostTA(file, TA, initStates);
+  BooleanPieceCoalescer<SignalVariables, Value> coalescer(TA);
+
+  // Each piece is given in its own block as in the online monitoring
+  const std::vector<Value> x3 = {11, 20, 0, 5, -11, -30, 12};
+  const std::vector<double> durations = {1, 2, 3, 4, 5, 6, 7};
+  const Value zero = 0;
+  std::vector<double> mergedDurations, allDurations;
+  std::vector<std::vector<Value>> mergedColumns;
+  std::vector<Value> allX3;
+  for (std::size_t i = 0; i < x3.size(); i++) {
+    const std::vector<const Value*> columns = {&zero, &zero, &zero, &x3[i]};
+    const std::size_t mergedSize = coalescer.coalesce(1, &durations[i], columns, mergedDurations, mergedColumns);
+    BOOST_REQUIRE_LE(mergedSize, 1);
+    allDurations.insert(allDurations.end(), mergedDurations.begin(), mergedDurations.begin() + mergedSize);
+    allX3.insert(allX3.end(), mergedColumns[3].begin(), mergedColumns[3].begin() + mergedSize);
+  }
+  const std::size_t mergedSize = coalescer.flush(mergedDurations, mergedColumns);
+  allDurations.insert(allDurations.end(), mergedDurations.begin(), mergedDurations.begin() + mergedSize);
+  allX3.insert(allX3.end(), mergedColumns[3].begin(), mergedColumns[3].begin() + mergedSize);
+
+  // The same runs as the pieces in one block
+  const std::vector<double> expectedDurations = {3, 7, 11, 7};
+  const std::vector<Value> expectedX3 = {11, 0, -11, 12};
+  BOOST_CHECK_EQUAL_COLLECTIONS(allDurations.begin(), allDurations.end(), expectedDurations.begin(), expectedDurations.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(allX3.begin(), allX3.end(), expectedX3.begin(), expectedX3.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,44 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../src/piece_store.hh"
+
+BOOST_AUTO_TEST_SUITE(PieceStoreTest)
+
+BOOST_AUTO_TEST_CASE(ringTest)
+{
+  PieceStore<double> pieces;
+  // The buffer grows and wraps around while the old pieces are discarded
+  for (std::size_t i = 0; i < 20; i++) {
+    BOOST_CHECK_EQUAL(pieces.push({double(i), -double(i)}), i);
+    if (i >= 5) {
+      pieces.discardBefore(i - 5);
+    }
+  }
+  BOOST_CHECK_EQUAL(pieces.getBegin(), 14);
+  BOOST_CHECK_EQUAL(pieces.getEnd(), 20);
+  for (std::size_t i = pieces.getBegin(); i < pieces.getEnd(); i++) {
+    BOOST_CHECK_EQUAL(pieces[i][0], i);
+    BOOST_CHECK_EQUAL(pieces[i][1], -double(i));
+  }
+
+  const PieceHistory<double> history(pieces, PieceRange{17, 20});
+  BOOST_CHECK_EQUAL(history.size(), 3);
+  BOOST_CHECK_EQUAL(history.back()[0], 19);
+  double sum = 0;
+  for (const auto &valuation: history) {
+    sum += valuation[0];
+  }
+  BOOST_CHECK_EQUAL(sum, 17 + 18 + 19);
+}
+
+BOOST_AUTO_TEST_CASE(rangeTest)
+{
+  const PieceRange empty{3, 3};
+  BOOST_CHECK(empty == (PieceRange{5, 5}));
+  BOOST_CHECK_EQUAL(hash_value(empty), hash_value(PieceRange{5, 5}));
+  BOOST_CHECK(empty.extendedTo(7) == (PieceRange{7, 8}));
+  BOOST_CHECK((PieceRange{4, 8}).extendedTo(8) == (PieceRange{4, 9}));
+  BOOST_CHECK((PieceRange{4, 8}) != (PieceRange{5, 8}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include "../src/qtpm_driver.hh"
+#include "../src/unix_socket.hh"
+
+BOOST_AUTO_TEST_SUITE(QTPMDriverTest)
+
+//! @brief Run a session over a socketpair sending the signal as the client does and return the received result
+static std::string runSession(const std::list<AutomatonSpec> &automata, const MonitorOptions &monitorOptions,
+                              const std::string &signal) {
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  QTPMOptions options = {false, "", 0, 1, 1};
+  std::thread session(serveSession, fds[0], "session", std::cref(automata), std::cref(monitorOptions), options);
+  BOOST_CHECK(writeAll(fds[1], signal.data(), signal.size()));
+  // The end of the signal
+  shutdown(fds[1], SHUT_WR);
+  std::string result;
+  char buffer[4096];
+  ssize_t size;
+  while ((size = read(fds[1], buffer, sizeof(buffer))) > 0) {
+    result.append(buffer, size);
+  }
+  session.join();
+  close(fds[1]);
+  return result;
+}
+
+//! @brief The lines of the text in the lexicographic order
+static std::vector<std::string> sortedLines(const std::string &text) {
+  std::vector<std::string> lines;
+  std::istringstream stream(text);
+  for (std::string line; std::getline(stream, line);) {
+    lines.push_back(line);
+  }
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+BOOST_AUTO_TEST_CASE( serveSessionTest )
+{
+  std::list<AutomatonSpec> automata(1);
+  automata.back().name = "paper";
+  automata.back().semiring = "maxmin";
+  std::ifstream file("../example/paper.dot");
+  parseBoostTA(file, automata.back().TA, automata.back().initStates);
+  MonitorOptions monitorOptions = {false, false, false, boost::none};
+  monitorOptions.resultFormat = ResultFormat::csv;
+
+  const std::vector<std::vector<Value>> valuations = {{110, 10}, {140, 40}, {180, 60}, {130, 20}};
+  const std::vector<double> durations = {2.5, 1.0, 3.0, 2.0};
+  const auto header = BinarySignalReader::makeHeader(2, false, BinarySignalReader::ValueType::float64,
+                                                     BinarySignalReader::Layout::records);
+  std::string signal(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (std::size_t i = 0; i < valuations.size(); i++) {
+    signal.append(reinterpret_cast<const char *>(&durations[i]), sizeof(double));
+    signal.append(reinterpret_cast<const char *>(valuations[i].data()), valuations[i].size() * sizeof(double));
+  }
+
+  // The session prints the same result as the signal read from a file piece by piece
+  char *buffer = nullptr;
+  std::size_t size = 0;
+  FILE *out = open_memstream(&buffer, &size);
+  // The reader needs a file descriptor
+  FILE *in = tmpfile();
+  fwrite(signal.data(), 1, signal.size(), in);
+  rewind(in);
+  {
+    auto monitors = makeMonitors(automata, monitorOptions, out);
+    auto reader = makeSignalReader(in, "signal", "binary");
+    const QTPMOptions options = {false, "", 0, 1, 1};
+    BOOST_CHECK_EQUAL(QTPM(monitors, *reader, options), valuations.size());
+  }
+  fclose(in);
+  fclose(out);
+  const std::string expected(buffer, size);
+  free(buffer);
+  BOOST_CHECK(!expected.empty());
+  // The matching is printed in the order of a hash table
+  BOOST_CHECK(sortedLines(runSession(automata, monitorOptions, signal)) == sortedLines(ResultWriter::header(ResultFormat::csv) + expected));
+
+  // A broken signal ends only the session, after the result header
+  BOOST_CHECK_EQUAL(runSession(automata, monitorOptions, "not a binary signal"), ResultWriter::header(ResultFormat::csv));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,13 +1,161 @@
 #include <queue>
+#include <cstring>
 #include <iostream>
+#include <sstream>
 #include <boost/test/unit_test.hpp>
 #include <boost/mpl/list.hpp>
 #include "../src/weighted_graph.hh"
 #include "../src/robustness.hh"
 #include "../src/quantitative_timed_pattern_matching.hh"
+#include "../src/chunked_matching.hh"
+#include "../src/piece_coalescer.hh"
+#include "../src/timed_automaton_analysis.hh"
+#include "../src/timed_automaton_preprocessing.hh"
 
 BOOST_AUTO_TEST_SUITE(QuantitativeTimedPatternMatchingTest)
 
+/*!
+  @brief Sample the weight of the matching at each (t, t') on a grid
+
+  The partition of the result into zones depends on the order of merging. We compare the results by the weight of each point.
+ */
+template<class Weight>
+static std::vector<Weight> sampleResult(const boost::unordered_map<std::array<Bounds, 6>, Weight> &result, double maxTime, double step = 0.25) {
+  const auto contains = [](const Bounds &lower, const Bounds &upper, double x) {
+    return (-lower.first < x || (-lower.first == x && lower.second)) &&
+      (x < upper.first || (x == upper.first && upper.second));
+  };
+  std::vector<Weight> samples;
+  for (double t = 0.1; t < maxTime; t += step) {
+    for (double tt = t + 0.05; tt < maxTime; tt += step) {
+      Weight w = Weight::zero();
+      for (const auto &r: result) {
+        if (contains(r.first[0], r.first[1], t) && contains(r.first[2], r.first[3], tt) &&
+            contains(r.first[4], r.first[5], tt - t)) {
+          w += r.second;
+        }
+      }
+      samples.push_back(w);
+    }
+  }
+  return samples;
+}
+
+//! @brief A signal given piece by piece
+struct TestSignal {
+  std::vector<std::vector<double>> valuations;
+  std::vector<double> durations;
+  //! @brief The total duration
+  double maxTime = 0;
+
+  void push(const std::vector<double> &valuation, double duration) {
+    valuations.push_back(valuation);
+    durations.push_back(duration);
+    maxTime += duration;
+  }
+
+  std::size_t size() const {
+    return valuations.size();
+  }
+};
+
+//! @brief A signal for experiments/ringing.dot, where x3 rises and falls irregularly
+static TestSignal ringingSignal(int size) {
+  TestSignal signal;
+  for (int i = 0; i < size; i++) {
+    signal.push({0, 0, 0, double((i * 37) % 41 - 20)}, 1 + (i * 7) % 5);
+  }
+  return signal;
+}
+
+//! @brief A timed automaton and the cost function to construct the matchers
+template<class Weight>
+struct TestAutomaton {
+  using SignalVariables = uint8_t;
+  using ClockVariables = uint8_t;
+  using Value = double;
+  using QTPM = QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value>;
+
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStatesTA;
+  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
+
+  explicit TestAutomaton(std::istream &&file) {
+    parseBoostTA(file, TA, initStatesTA);
+  }
+
+  QTPM makeMatcher(bool ignoreZero = false) const {
+    return QTPM(TA, initStatesTA, cost, ignoreZero);
+  }
+};
+
+/*!
+  @brief Compare a variant of the matcher with the exact matcher on the same signal
+
+  The exact matcher, which does not prune the dominated configurations, is fed with the signal piece by piece on the construction. The results are compared by the weights sampled by @ref sampleResult.
+ */
+template<class Weight>
+struct ExactComparison : public TestAutomaton<Weight> {
+  using typename TestAutomaton<Weight>::QTPM;
+  using Result = boost::unordered_map<std::array<Bounds, 6>, Weight>;
+  //! @brief The relation between the exact weight and the weight of the variant at each sample
+  using Relation = std::function<bool(const Weight &exact, const Weight &variant)>;
+
+  const TestSignal signal;
+  const double step;
+  QTPM exact;
+  Result exactResult;
+  std::vector<Weight> exactSamples;
+  //! @brief The number of the configurations of the exact matcher summed over the pieces
+  std::size_t exactConfigurations = 0;
+
+  ExactComparison(std::istream &&file, TestSignal signal, double step) :
+    TestAutomaton<Weight>(std::move(file)), signal(std::move(signal)), step(step), exact(this->makeMatcher()) {
+    exact.setPruneDominated(false);
+    for (std::size_t i = 0; i < this->signal.size(); i++) {
+      exact.feed(this->signal.valuations[i], this->signal.durations[i]);
+      exactConfigurations += exact.getNumOfConfigurations();
+    }
+    exact.getResult(exactResult);
+    exactSamples = sampleResult(exactResult, this->signal.maxTime, step);
+  }
+
+  //! @brief Compare on experiments/ringing.dot
+  ExactComparison(TestSignal signal, double step) :
+    ExactComparison(std::ifstream("../experiments/ringing.dot"), std::move(signal), step) {}
+
+  static bool equal(const Weight &exact, const Weight &variant) {
+    return exact.data == variant.data;
+  }
+
+  /*!
+    @brief Feed the signal to the variant piece by piece and compare its result with the exact one
+
+    @returns The number of the configurations of the variant summed over the pieces
+   */
+  std::size_t compareWithExact(QTPM &variant, const Relation &relation = equal) {
+    std::size_t variantConfigurations = 0;
+    for (std::size_t i = 0; i < signal.size(); i++) {
+      variant.feed(signal.valuations[i], signal.durations[i]);
+      variantConfigurations += variant.getNumOfConfigurations();
+    }
+    Result variantResult;
+    variant.getResult(variantResult);
+    compareWithExact(variantResult, relation);
+    return variantConfigurations;
+  }
+
+  //! @brief Compare the result of the variant computed otherwise, e.g., by a restored matcher, with the exact one
+  void compareWithExact(const Result &variantResult, const Relation &relation = equal) const {
+    const auto variantSamples = sampleResult(variantResult, signal.maxTime, step);
+    BOOST_REQUIRE_EQUAL(exactSamples.size(), variantSamples.size());
+    for (std::size_t i = 0; i < exactSamples.size(); i++) {
+      BOOST_CHECK_MESSAGE(relation(exactSamples[i], variantSamples[i]),
+                          "sample " << i << ": exact " << exactSamples[i].data << ", variant " << variantSamples[i].data);
+    }
+  }
+};
+
 BOOST_AUTO_TEST_CASE( QTPMTest0 )
 {
   using SignalVariables = uint8_t;
@@ -25,7 +173,7 @@ BOOST_AUTO_TEST_CASE( QTPMTest0 )
   const auto num_of_vars = boost::get_property(TA, boost::graph_num_of_vars);
   BOOST_CHECK_EQUAL(num_of_vars, 0);
 
-  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables>;
+  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
   
   QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> qtpm(TA, initStatesTA, cost);
 
@@ -45,4 +193,717 @@ BOOST_AUTO_TEST_CASE( QTPMTest0 )
                                     }).data, -80);
 }
 
+BOOST_AUTO_TEST_CASE( QTPMReusedDescriptorTest )
+{
+  using SignalVariables = uint8_t;
+  using ClockVariables = uint8_t;
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../example/small.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStatesTA;
+
+  parseBoostTA(file, TA, initStatesTA);
+
+  using Weight = MinPlusSemiring<double>;
+  using Value = double;
+  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
+
+  QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> qtpm(TA, initStatesTA, cost);
+
+  // The vertices of the last piece reuse the descriptors of the vertices removed in the same piece.
+  // The reuse depends on the allocation, and we remove the result after each piece as the command line does.
+  std::vector<std::vector<Value>> valuations = {{169, 28}, {200, 12}, {181, 30}, {97, 6}, {127, 9}, {187, 51}};
+  std::vector<double> durations = {3, 3, 0.5, 3, 2, 0.25};
+  for (std::size_t i = 0; i + 1 < valuations.size(); i++) {
+    qtpm.feed(valuations[i], durations[i]);
+    qtpm.getResultRef().clear();
+  }
+  qtpm.feed(valuations.back(), durations.back());
+
+  boost::unordered_map<decltype(qtpm)::ResultMatrix, Weight> result;
+  qtpm.getResult(result);
+
+  // 11.5 <= t < 11.75, 11.5 < t' <= 11.75, and 0 < t' - t <= 0.25 in the last piece with the weight (87 - 21) + 87
+  const decltype(qtpm)::ResultMatrix lastPiece = {{{-11.5, true}, {11.75, false}, {-11.5, false}, {11.75, true}, {0, false}, {0.25, true}}};
+  const auto it = std::find_if(result.begin(), result.end(), [&](const auto &p) {
+      return p.first == lastPiece;
+    });
+  BOOST_REQUIRE(it != result.end());
+  BOOST_CHECK_EQUAL(it->second.data, 153);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMLeaveInLaterPieceTest )
+{
+  using SignalVariables = uint8_t;
+  using ClockVariables = uint8_t;
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../test/timed_automaton.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStatesTA;
+
+  parseBoostTA(file, TA, initStatesTA);
+
+  using Weight = MaxMinSemiring<double>;
+  using Value = double;
+  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
+
+  QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> qtpm(TA, initStatesTA, cost);
+
+  // The matching requires t' - t > 1, and a run starting in the middle of the first piece can leave only in the second piece
+  std::vector<std::vector<Value>> valuations = {{0}, {0}};
+  std::vector<double> durations = {1, 0.5};
+  for (std::size_t i = 0; i < valuations.size(); i++) {
+    qtpm.feed(valuations[i], durations[i]);
+  }
+
+  boost::unordered_map<decltype(qtpm)::ResultMatrix, Weight> result;
+  qtpm.getResult(result);
+
+  // 0 <= t < 0.5, 1 < t' <= 1.5, and 1 < t' - t <= 1.5
+  const decltype(qtpm)::ResultMatrix laterPiece = {{{0, true}, {0.5, false}, {-1, false}, {1.5, true}, {-1, false}, {1.5, true}}};
+  BOOST_REQUIRE_EQUAL(result.size(), 1);
+  BOOST_CHECK(result.begin()->first == laterPiece);
+  BOOST_CHECK_EQUAL(result.begin()->second.data, Weight::one().data);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMStreamTest )
+{
+  using SignalVariables = uint8_t;
+  using ClockVariables = uint8_t;
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  // The duration of the matching is bounded, and thus the watermark advances
+  std::ifstream file("../experiments/ringing.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStatesTA;
+
+  parseBoostTA(file, TA, initStatesTA);
+
+  using Weight = MaxMinSemiring<double>;
+  using Value = double;
+  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
+
+  QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> batch(TA, initStatesTA, cost);
+  QuantitativeTimedPatternMatching<SignalVariables, ClockVariables, Weight, Value> stream(TA, initStatesTA, cost);
+  boost::unordered_map<decltype(stream)::ResultMatrix, Weight> streamResult;
+  bool flushing = false;
+  stream.setResultSink([&](const decltype(stream)::ResultMatrix &mat, const Weight &w, bool approximate) {
+      BOOST_CHECK(!approximate);
+      // each matching is emitted only once and only after it is behind the watermark at the emission
+      BOOST_CHECK(streamResult.find(mat) == streamResult.end());
+      if (!flushing) {
+        BOOST_CHECK_LE(mat[1].first, stream.getWatermark());
+      }
+      streamResult[mat] = w;
+    });
+
+  double lastWatermark = 0, maxTime = 0;
+  for (int i = 0; i < 40; i++) {
+    const std::vector<Value> valuation = {0, 0, 0, double((i * 37) % 41 - 20)};
+    const double duration = 1 + (i * 7) % 5;
+    batch.feed(valuation, duration);
+    stream.feed(valuation, duration);
+    maxTime += duration;
+    BOOST_CHECK_LE(lastWatermark, stream.getWatermark());
+    lastWatermark = stream.getWatermark();
+  }
+  // Some matching is finalized before the end of the signal
+  BOOST_CHECK(!streamResult.empty());
+  // The rest is emitted regardless of the watermark
+  flushing = true;
+  stream.flushResult();
+  BOOST_CHECK(stream.getResultRef().empty());
+
+  boost::unordered_map<decltype(batch)::ResultMatrix, Weight> batchResult;
+  batch.getResult(batchResult);
+  BOOST_CHECK(!batchResult.empty());
+  BOOST_CHECK(sampleResult(batchResult, maxTime, 1.0) == sampleResult(streamResult, maxTime, 1.0));
+}
+
+BOOST_AUTO_TEST_CASE( QTPMPruneDominatedTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 1.0);
+  auto pruned = comparison.makeMatcher();
+  pruned.setPruneDominated(true);
+
+  BOOST_CHECK(!comparison.exactResult.empty());
+  BOOST_CHECK_LT(comparison.compareWithExact(pruned), comparison.exactConfigurations);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMPruneNothingDominatedTest )
+{
+  // In the Boolean semantics, no two configurations have the same state and history on this signal
+  using Weight = BooleanSemiring;
+  ExactComparison<Weight> comparison(ringingSignal(15), 1.0);
+  auto pruned = comparison.makeMatcher();
+  pruned.setPruneDominated(true);
+
+  // No configuration is removed without a dominating one
+  BOOST_CHECK(!comparison.exactResult.empty());
+  BOOST_CHECK_EQUAL(comparison.compareWithExact(pruned), comparison.exactConfigurations);
+}
+
+//! @brief The weight is not changed if it reaches the threshold and it is zero otherwise
+template<class Weight>
+static bool keptIfReaching(const Weight &threshold, const Weight &exact, const Weight &thresholded) {
+  return exact.data >= threshold.data ? thresholded.data == exact.data : thresholded.data == Weight::zero().data;
+}
+
+BOOST_AUTO_TEST_CASE( QTPMThresholdTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 1.0);
+  auto thresholded = comparison.makeMatcher();
+  const Weight threshold = -5;
+  thresholded.setThreshold(threshold);
+
+  BOOST_CHECK_LT(comparison.compareWithExact(thresholded, [&](const Weight &exact, const Weight &variant) {
+        return keptIfReaching(threshold, exact, variant);
+      }), comparison.exactConfigurations);
+  BOOST_CHECK(std::any_of(comparison.exactSamples.begin(), comparison.exactSamples.end(), [&](const Weight &w) {
+        return w.data >= threshold.data;
+      }));
+
+  boost::unordered_map<std::array<Bounds, 6>, Weight> thresholdedResult;
+  thresholded.getResult(thresholdedResult);
+  BOOST_CHECK_LT(thresholdedResult.size(), comparison.exactResult.size());
+  BOOST_CHECK(std::all_of(thresholdedResult.begin(), thresholdedResult.end(), [&](const auto &r) {
+        return r.second.data >= threshold.data;
+      }));
+}
+
+BOOST_AUTO_TEST_CASE( QTPMThresholdReachedExactlyTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 1.0);
+  // The threshold is exactly the largest weight
+  const Weight threshold = std::accumulate(comparison.exactSamples.begin(), comparison.exactSamples.end(), Weight::zero());
+  BOOST_REQUIRE(threshold != Weight::zero());
+  auto thresholded = comparison.makeMatcher();
+  thresholded.setThreshold(threshold);
+
+  comparison.compareWithExact(thresholded, [&](const Weight &exact, const Weight &variant) {
+      return keptIfReaching(threshold, exact, variant);
+    });
+  boost::unordered_map<std::array<Bounds, 6>, Weight> thresholdedResult;
+  thresholded.getResult(thresholdedResult);
+  BOOST_CHECK(!thresholdedResult.empty());
+}
+
+BOOST_AUTO_TEST_CASE( QTPMCheckpointTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(12), 1.0);
+  const TestSignal &signal = comparison.signal;
+  auto original = comparison.makeMatcher();
+  auto restored = comparison.makeMatcher();
+  for (std::size_t i = 0; i < 8; i++) {
+    original.feed(signal.valuations[i], signal.durations[i]);
+  }
+
+  std::stringstream checkpoint;
+  original.saveCheckpoint(checkpoint);
+  BOOST_REQUIRE(restored.loadCheckpoint(checkpoint));
+  BOOST_CHECK_EQUAL(restored.getNumOfConfigurations(), original.getNumOfConfigurations());
+  BOOST_CHECK_EQUAL(restored.getAbsTime(), original.getAbsTime());
+
+  for (std::size_t i = 8; i < signal.size(); i++) {
+    restored.feed(signal.valuations[i], signal.durations[i]);
+  }
+  boost::unordered_map<std::array<Bounds, 6>, Weight> restoredResult;
+  restored.getResult(restoredResult);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  comparison.compareWithExact(restoredResult);
+
+  // A broken checkpoint is rejected without changing the state
+  std::stringstream broken(checkpoint.str().substr(0, 20));
+  BOOST_CHECK(!restored.loadCheckpoint(broken));
+  BOOST_CHECK_EQUAL(restored.getAbsTime(), signal.maxTime);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMCheckpointBoundsTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  const TestSignal signal = ringingSignal(8);
+  TestAutomaton<Weight> automaton(std::ifstream("../experiments/ringing.dot"));
+  auto original = automaton.makeMatcher();
+  for (std::size_t i = 0; i < signal.size(); i++) {
+    original.feed(signal.valuations[i], signal.durations[i]);
+  }
+  std::stringstream checkpoint;
+  original.saveCheckpoint(checkpoint);
+  const std::string bytes = checkpoint.str();
+
+  // The offsets after the header of the magic number, the version, the sizes and the fingerprint of the TA, and the three times
+  const std::size_t piecesOffset = 8 + sizeof(uint32_t) + sizeof(uint64_t) * 3 + sizeof(double) * 3;
+  uint64_t numOfPieces, width;
+  std::memcpy(&numOfPieces, bytes.data() + piecesOffset, sizeof(uint64_t));
+  std::memcpy(&width, bytes.data() + piecesOffset + sizeof(uint64_t), sizeof(uint64_t));
+  BOOST_REQUIRE_GT(numOfPieces, 1);
+  BOOST_REQUIRE_EQUAL(width, 4);
+  const std::size_t configurationsOffset = piecesOffset + sizeof(uint64_t) + numOfPieces * sizeof(uint64_t) * (1 + width);
+  const std::size_t dimensionOffset = configurationsOffset + sizeof(uint64_t) * 2 + sizeof(uint8_t);
+
+  // Each forged size is rejected before allocating the memory for it, and the state is not changed
+  const auto forged = [&](std::size_t offset, auto value) {
+    std::string forgedBytes = bytes;
+    std::memcpy(&forgedBytes[offset], &value, sizeof(value));
+    std::stringstream forgedCheckpoint(forgedBytes);
+    auto restored = automaton.makeMatcher();
+    BOOST_CHECK(!restored.loadCheckpoint(forgedCheckpoint));
+    BOOST_CHECK_EQUAL(restored.getAbsTime(), 0);
+    BOOST_CHECK_EQUAL(restored.getNumOfConfigurations(), 0);
+  };
+  forged(piecesOffset, uint64_t(1) << 60);
+  forged(piecesOffset + sizeof(uint64_t), uint64_t(1) << 60);
+  // The second piece has a width different from the first one
+  forged(piecesOffset + sizeof(uint64_t) * (2 + width), uint64_t(width + 1));
+  forged(configurationsOffset, uint64_t(1) << 60);
+  forged(dimensionOffset, uint32_t(1) << 30);
+  forged(dimensionOffset, uint32_t(0));
+
+  // The unmodified checkpoint is loaded
+  std::stringstream valid(bytes);
+  auto restored = automaton.makeMatcher();
+  BOOST_CHECK(restored.loadCheckpoint(valid));
+  BOOST_CHECK_EQUAL(restored.getNumOfConfigurations(), original.getNumOfConfigurations());
+}
+
+BOOST_AUTO_TEST_CASE( QTPMCheckpointMidDwellTest )
+{
+  // The 9th piece (x3 = -11 for 2 time units) is split into two halves and the checkpoint is taken between them.
+  // The runs dwelling in the fall state keep the first half in their histories over the checkpoint.
+  TestSignal signal;
+  const TestSignal ringing = ringingSignal(12);
+  for (std::size_t i = 0; i < ringing.size(); i++) {
+    if (i == 8) {
+      signal.push(ringing.valuations[i], ringing.durations[i] / 2);
+    }
+    signal.push(ringing.valuations[i], i == 8 ? ringing.durations[i] / 2 : ringing.durations[i]);
+  }
+  // The weight depends on the whole history in the max-plus semantics
+  using Weight = MaxPlusSemiring<double>;
+  ExactComparison<Weight> comparison(std::move(signal), 1.0);
+  auto original = comparison.makeMatcher();
+  auto restored = comparison.makeMatcher();
+  for (std::size_t i = 0; i < 9; i++) {
+    original.feed(comparison.signal.valuations[i], comparison.signal.durations[i]);
+  }
+
+  std::stringstream checkpoint;
+  original.saveCheckpoint(checkpoint);
+  BOOST_REQUIRE(restored.loadCheckpoint(checkpoint));
+
+  for (std::size_t i = 9; i < comparison.signal.size(); i++) {
+    restored.feed(comparison.signal.valuations[i], comparison.signal.durations[i]);
+  }
+  boost::unordered_map<std::array<Bounds, 6>, Weight> restoredResult;
+  restored.getResult(restoredResult);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  comparison.compareWithExact(restoredResult);
+}
+
+//! @brief experiments/ringing.dot with a shorter bound of the duration
+static const char *const shortRingingTA =
+  "digraph G {\n"
+  "rise [label=\"{x3 > 10}\"][init=1][match=0];\n"
+  "afterrise [init=0][match=0];\n"
+  "fall [label=\"{x3 < -10}\"][init=0][match=0];\n"
+  "afterfall [init=0][match=0];\n"
+  "fin [init=0][match=1];\n"
+  "rise->afterrise [guard=\"{x0 < 20, x1 < 12}\"];\n"
+  "afterrise->fall [guard=\"{x0 < 20, x1 < 12}\"];\n"
+  "fall->afterfall [guard=\"{x0 < 20, x1 < 12}\"][reset=\"{0}\"];\n"
+  "afterfall->rise [guard=\"{x0 < 20, x1 < 12}\"];\n"
+  "fall->fin [guard=\"{x0 < 20, x1 <= 12}\"];\n"
+  "}\n";
+
+BOOST_AUTO_TEST_CASE( QTPMCheckpointOtherAutomatonTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  const TestSignal signal = ringingSignal(8);
+  TestAutomaton<Weight> automaton(std::ifstream("../experiments/ringing.dot"));
+  // The same numbers of the states and the clock variables with different guards
+  TestAutomaton<Weight> edited{std::stringstream(shortRingingTA)};
+  BOOST_REQUIRE_EQUAL(boost::num_vertices(edited.TA), boost::num_vertices(automaton.TA));
+  auto original = automaton.makeMatcher();
+  for (std::size_t i = 0; i < signal.size(); i++) {
+    original.feed(signal.valuations[i], signal.durations[i]);
+  }
+  std::stringstream checkpoint;
+  original.saveCheckpoint(checkpoint);
+
+  auto restored = edited.makeMatcher();
+  BOOST_CHECK(!restored.loadCheckpoint(checkpoint));
+  BOOST_CHECK_EQUAL(restored.getNumOfConfigurations(), 0);
+  BOOST_CHECK_NE(automatonFingerprint(edited.TA), automatonFingerprint(automaton.TA));
+}
+
+//! @brief Match the signal of the comparison by chunkedMatching and collect the result
+template<class Weight>
+static boost::unordered_map<std::array<Bounds, 6>, Weight> matchInChunks(const ExactComparison<Weight> &comparison, std::size_t numOfChunks) {
+  const auto maxDuration = maxMatchDuration(comparison.TA, comparison.initStatesTA);
+  BOOST_REQUIRE(maxDuration);
+  BOOST_CHECK_EQUAL(*maxDuration, 12);
+
+  ThreadPool pool(2);
+  const auto prototype = comparison.makeMatcher();
+  boost::unordered_map<std::array<Bounds, 6>, Weight> result;
+  std::size_t numOfEmitted = 0;
+  chunkedMatching(prototype, comparison.signal.valuations, comparison.signal.durations, *maxDuration, pool, numOfChunks,
+                  [&](const std::array<Bounds, 6> &arr, const Weight &weight, bool) {
+                    numOfEmitted++;
+                    auto it = result.find(arr);
+                    if (it == result.end()) {
+                      result.emplace(arr, weight);
+                    } else {
+                      it->second += weight;
+                    }
+                  });
+  // The duplicated matching at the boundaries is merged
+  BOOST_CHECK_EQUAL(numOfEmitted, result.size());
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE( QTPMChunkedTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(std::stringstream(shortRingingTA), ringingSignal(40), 0.5);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  comparison.compareWithExact(matchInChunks(comparison, 4));
+}
+
+BOOST_AUTO_TEST_CASE( QTPMChunkedMoreChunksThanPiecesTest )
+{
+  // Each chunk is widened to the bound of the duration, and most of the matching crosses a boundary
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(std::stringstream(shortRingingTA), ringingSignal(40), 0.5);
+  comparison.compareWithExact(matchInChunks(comparison, 100));
+}
+
+//! @brief Feed the pieces [begin, end) of the signal to the matcher as a block given by columns
+template<class QTPM>
+static void feedBlock(QTPM &matcher, const TestSignal &signal, std::size_t begin, std::size_t end) {
+  std::vector<std::vector<double>> columns(signal.valuations.front().size());
+  for (std::size_t i = begin; i < end; i++) {
+    for (std::size_t j = 0; j < columns.size(); j++) {
+      columns[j].push_back(signal.valuations[i][j]);
+    }
+  }
+  std::vector<const double*> columnPointers;
+  for (const auto &column: columns) {
+    columnPointers.push_back(column.data());
+  }
+  matcher.feedBatch(end - begin, signal.durations.data() + begin, columnPointers);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMFeedBatchTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 0.5);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  // With and without the table of the labels
+  for (bool labelTable: {true, false}) {
+    auto batch = comparison.makeMatcher();
+    batch.useLabelTable(labelTable);
+    // Split into two blocks
+    feedBlock(batch, comparison.signal, 0, 10);
+    feedBlock(batch, comparison.signal, 10, 15);
+
+    BOOST_CHECK_EQUAL(batch.getAbsTime(), comparison.signal.maxTime);
+    boost::unordered_map<std::array<Bounds, 6>, Weight> batchResult;
+    batch.getResult(batchResult);
+    comparison.compareWithExact(batchResult);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( QTPMFeedBatchMixedTest )
+{
+  // The histories span the single pieces, the empty and one-piece blocks, and the longer blocks.
+  // The weight depends on the whole history in the max-plus semantics.
+  using Weight = MaxPlusSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 0.5);
+  auto batch = comparison.makeMatcher();
+  batch.useLabelTable(true);
+  for (std::size_t i = 0; i < 3; i++) {
+    batch.feed(comparison.signal.valuations[i], comparison.signal.durations[i]);
+  }
+  feedBlock(batch, comparison.signal, 3, 3);
+  feedBlock(batch, comparison.signal, 3, 4);
+  feedBlock(batch, comparison.signal, 4, 9);
+  batch.feed(comparison.signal.valuations[9], comparison.signal.durations[9]);
+  feedBlock(batch, comparison.signal, 10, 15);
+
+  BOOST_CHECK_EQUAL(batch.getAbsTime(), comparison.signal.maxTime);
+  boost::unordered_map<std::array<Bounds, 6>, Weight> batchResult;
+  batch.getResult(batchResult);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  comparison.compareWithExact(batchResult);
+}
+
+//! @brief Feed the signal of the comparison after coalescing its pieces and collect the result
+static boost::unordered_map<std::array<Bounds, 6>, BooleanSemiring> matchCoalesced(const ExactComparison<BooleanSemiring> &comparison, std::size_t expectedSize) {
+  BooleanPieceCoalescer<uint8_t, double> coalescer(comparison.TA);
+  std::vector<std::vector<double>> mergedValuations;
+  std::vector<double> mergedDurations;
+  coalescer.coalesce(comparison.signal.valuations, comparison.signal.durations, mergedValuations, mergedDurations);
+  BOOST_CHECK_EQUAL(mergedValuations.size(), expectedSize);
+
+  auto coalesced = comparison.makeMatcher();
+  for (std::size_t i = 0; i < mergedValuations.size(); i++) {
+    coalesced.feed(mergedValuations[i], mergedDurations[i]);
+  }
+  boost::unordered_map<std::array<Bounds, 6>, BooleanSemiring> result;
+  coalesced.getResult(result);
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE( QTPMBooleanCoalescingTest )
+{
+  // A high-frequency signal whose truth values change every 8 pieces
+  TestSignal signal;
+  for (int i = 0; i < 64; i++) {
+    const double noise = (i * 7) % 5;
+    const int phase = (i / 8) % 3;
+    signal.push({0, 0, 0, phase == 0 ? 11 + noise : phase == 1 ? -11 - noise : noise}, 0.5);
+  }
+  ExactComparison<BooleanSemiring> comparison(std::move(signal), 0.25);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  comparison.compareWithExact(matchCoalesced(comparison, 8));
+}
+
+BOOST_AUTO_TEST_CASE( QTPMBooleanCoalescingNothingMergedTest )
+{
+  // The truth values change at every piece, and no piece is merged
+  TestSignal signal;
+  for (int i = 0; i < 30; i++) {
+    const int phase = i % 3;
+    signal.push({0, 0, 0, phase == 0 ? 11.0 + i : phase == 1 ? -11.0 - i : 0}, 0.5 + (i % 4));
+  }
+  ExactComparison<BooleanSemiring> comparison(std::move(signal), 0.25);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  comparison.compareWithExact(matchCoalesced(comparison, 30));
+}
+
+BOOST_AUTO_TEST_CASE( QTPMIgnoreZeroTest )
+{
+  // Starting with the pieces where no matching can begin
+  TestSignal signal = ringingSignal(20);
+  for (std::size_t i = 0; i < 3; i++) {
+    signal.valuations[i][3] = 0;
+  }
+  using Weight = BooleanSemiring;
+  ExactComparison<Weight> comparison(std::move(signal), 0.5);
+  auto ignoringZero = comparison.makeMatcher(true);
+
+  BOOST_CHECK(!comparison.exactResult.empty());
+  BOOST_CHECK_LT(comparison.compareWithExact(ignoringZero), comparison.exactConfigurations);
+  BOOST_CHECK_EQUAL(ignoringZero.getAbsTime(), comparison.exact.getAbsTime());
+}
+
+BOOST_AUTO_TEST_CASE( QTPMIgnoreZeroNoMatchingTest )
+{
+  // x3 never exceeds 10, so no run leaves the initial state and no configuration is made at all
+  TestSignal signal;
+  for (int i = 0; i < 10; i++) {
+    signal.push({0, 0, 0, double(i % 3 - 1)}, 1 + i % 2);
+  }
+  using Weight = BooleanSemiring;
+  ExactComparison<Weight> comparison(std::move(signal), 0.5);
+  auto ignoringZero = comparison.makeMatcher(true);
+
+  BOOST_CHECK_EQUAL(comparison.compareWithExact(ignoringZero), 0);
+  BOOST_CHECK_GT(comparison.exactConfigurations, 0);
+  BOOST_CHECK(comparison.exactResult.empty());
+  BOOST_CHECK_EQUAL(ignoringZero.getAbsTime(), comparison.signal.maxTime);
+}
+
+//! @brief The over-approximation never loses the matching nor decreases its weight
+template<class Weight>
+static bool overApproximates(const Weight &exact, const Weight &approximated) {
+  return approximated.data >= exact.data;
+}
+
+BOOST_AUTO_TEST_CASE( QTPMMaxConfigurationsTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 0.5);
+  auto approximated = comparison.makeMatcher();
+  approximated.setMaxConfigurations(10);
+
+  BOOST_CHECK_LT(comparison.compareWithExact(approximated, overApproximates<Weight>), comparison.exactConfigurations);
+  BOOST_CHECK_GT(approximated.getNumOfApproximations(), 0);
+  BOOST_CHECK_GT(approximated.getNumOfMergedConfigurations(), 0);
+  BOOST_CHECK_EQUAL(comparison.exact.getNumOfApproximations(), 0);
+  BOOST_CHECK(std::none_of(comparison.exactResult.begin(), comparison.exactResult.end(), [&](const auto &r) {
+        return comparison.exact.isApproximate(r.first);
+      }));
+
+  boost::unordered_map<std::array<Bounds, 6>, Weight> approximatedResult;
+  approximated.getResult(approximatedResult);
+  BOOST_CHECK(std::any_of(approximatedResult.begin(), approximatedResult.end(), [&](const auto &r) {
+        return approximated.isApproximate(r.first);
+      }));
+}
+
+BOOST_AUTO_TEST_CASE( QTPMMaxConfigurationsOneTest )
+{
+  // The tightest budget: the configurations are merged whenever there are two or more of them
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 0.5);
+  auto approximated = comparison.makeMatcher();
+  approximated.setMaxConfigurations(1);
+
+  comparison.compareWithExact(approximated, overApproximates<Weight>);
+  BOOST_CHECK_GT(approximated.getNumOfApproximations(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMLatencyBudgetTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 0.5);
+  auto relaxed = comparison.makeMatcher();
+  auto degraded = comparison.makeMatcher();
+  relaxed.setLatencyBudget(1e6);
+  degraded.setLatencyBudget(1e-12);
+
+  // Within the budget, the result is exact. Otherwise, some matching may be missing.
+  comparison.compareWithExact(relaxed);
+  comparison.compareWithExact(degraded, [](const Weight &exact, const Weight &variant) {
+      return variant.data <= exact.data;
+    });
+  BOOST_CHECK(!relaxed.isDegraded());
+  BOOST_CHECK(degraded.isDegraded());
+  BOOST_CHECK_GE(degraded.getPhaseTimes().total(), 0);
+  relaxed.flushResult();
+  degraded.flushResult();
+  BOOST_CHECK(relaxed.getDegradedIntervalsRef().empty());
+  BOOST_REQUIRE_EQUAL(degraded.getDegradedIntervalsRef().size(), 1);
+  BOOST_CHECK_EQUAL(degraded.getDegradedIntervalsRef().front().second, comparison.signal.maxTime);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMLatencyBudgetRecoveryTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  const TestSignal signal = ringingSignal(15);
+  TestAutomaton<Weight> automaton(std::ifstream("../experiments/ringing.dot"));
+  auto matcher = automaton.makeMatcher();
+  using Level = decltype(matcher)::DegradedLevel;
+  // The level rises by one at each piece over the budget and falls by one at each piece within half of it
+  matcher.setLatencyBudget(1e-12);
+  const std::vector<Level> risingLevels = {Level::skipMerge, Level::sparseStarts, Level::noStarts, Level::noStarts, Level::noStarts};
+  for (std::size_t i = 0; i < 5; i++) {
+    matcher.feed(signal.valuations[i], signal.durations[i]);
+    BOOST_CHECK(matcher.getDegradedLevel() == risingLevels[i]);
+  }
+  BOOST_CHECK(matcher.isDegraded());
+  matcher.setLatencyBudget(1e6);
+  const std::vector<Level> fallingLevels = {Level::sparseStarts, Level::skipMerge, Level::exact};
+  for (std::size_t i = 5; i < 8; i++) {
+    matcher.feed(signal.valuations[i], signal.durations[i]);
+    BOOST_CHECK(matcher.getDegradedLevel() == fallingLevels[i - 5]);
+  }
+  BOOST_CHECK(!matcher.isDegraded());
+
+  // The degraded interval covers only the pieces where the starts are limited
+  const double begin = signal.durations[0] + signal.durations[1];
+  const double end = std::accumulate(signal.durations.begin(), signal.durations.begin() + 7, 0.0);
+  BOOST_REQUIRE_EQUAL(matcher.getDegradedIntervalsRef().size(), 1);
+  BOOST_CHECK_EQUAL(matcher.getDegradedIntervalsRef().front().first, begin);
+  BOOST_CHECK_EQUAL(matcher.getDegradedIntervalsRef().front().second, end);
+  matcher.flushResult();
+  BOOST_CHECK_EQUAL(matcher.getDegradedIntervalsRef().size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMLatencyBudgetSkipMergeTest )
+{
+  // At the first level of the degraded mode, only the merging of the zones is skipped and no matching is lost
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(ringingSignal(15), 0.5);
+  auto matcher = comparison.makeMatcher();
+  using Level = decltype(matcher)::DegradedLevel;
+  for (std::size_t i = 0; i < comparison.signal.size(); i++) {
+    // Each piece is over the budget and the next one is within it, which keeps the level at skipMerge
+    matcher.setLatencyBudget(i % 2 ? 1e6 : 1e-12);
+    matcher.feed(comparison.signal.valuations[i], comparison.signal.durations[i]);
+    BOOST_CHECK(matcher.getDegradedLevel() == (i % 2 ? Level::exact : Level::skipMerge));
+  }
+  boost::unordered_map<std::array<Bounds, 6>, Weight> result;
+  matcher.getResult(result);
+  comparison.compareWithExact(result);
+  matcher.flushResult();
+  BOOST_CHECK(matcher.getDegradedIntervalsRef().empty());
+}
+
+BOOST_AUTO_TEST_CASE( QTPMPhaseTimesTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  const TestSignal signal = ringingSignal(10);
+  TestAutomaton<Weight> automaton(std::ifstream("../experiments/ringing.dot"));
+  auto unmeasured = automaton.makeMatcher();
+  auto measured = automaton.makeMatcher();
+  measured.setMeasurePhaseTimes(true);
+  for (std::size_t i = 0; i < signal.size(); i++) {
+    unmeasured.feed(signal.valuations[i], signal.durations[i]);
+    measured.feed(signal.valuations[i], signal.durations[i]);
+  }
+  // Without the latency budget, the clock is not read unless the phase times are requested
+  BOOST_CHECK_EQUAL(unmeasured.getPhaseTimes().total(), 0);
+  BOOST_CHECK_GT(measured.getPhaseTimes().total(), 0);
+  BOOST_CHECK(!measured.isDegraded());
+}
+
+//! @brief A signal for test/redundant.dot
+static TestSignal redundantSignal() {
+  TestSignal signal;
+  for (int i = 0; i < 20; i++) {
+    signal.push({double((i * 13) % 37)}, 1 + (i * 3) % 4);
+  }
+  return signal;
+}
+
+//! @brief Compare the matcher for the preprocessed timed automaton (see preprocessBoostTA) with the exact matcher for the original one
+template<class Weight>
+static void compareWithPreprocessed(ExactComparison<Weight> &comparison, std::istream &&file) {
+  TestAutomaton<Weight> preprocessed(std::move(file));
+  preprocessBoostTA(preprocessed.TA, preprocessed.initStatesTA);
+  auto matcher = preprocessed.makeMatcher();
+  comparison.compareWithExact(matcher);
+}
+
+BOOST_AUTO_TEST_CASE( QTPMPreprocessingTest )
+{
+  using Weight = MaxMinSemiring<double>;
+  ExactComparison<Weight> comparison(std::ifstream("../test/redundant.dot"), redundantSignal(), 0.5);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  // The preprocessing does not change the weight of any matching
+  compareWithPreprocessed(comparison, std::ifstream("../test/redundant.dot"));
+}
+
+BOOST_AUTO_TEST_CASE( QTPMPreprocessingHistoryTest )
+{
+  // The merged states and the renumbered clock variables keep the histories, which matter in the max-plus semiring
+  using Weight = MaxPlusSemiring<double>;
+  ExactComparison<Weight> comparison(std::ifstream("../test/redundant.dot"), redundantSignal(), 0.5);
+  BOOST_CHECK(!comparison.exactResult.empty());
+  compareWithPreprocessed(comparison, std::ifstream("../test/redundant.dot"));
+}
+
+BOOST_AUTO_TEST_CASE( QTPMPreprocessingNoAcceptingTest )
+{
+  // The accepting state is reachable only by an unsatisfiable guard, and all the states are removed
+  const char *const TA =
+    "digraph G {\n"
+    "0 [label=\"{x0 > 5}\"][init=1][match=0];\n"
+    "1 [init=0][match=1];\n"
+    "0->0;\n"
+    "0->1 [guard=\"{x0 > 3, x0 < 2}\"];\n"
+    "}\n";
+  using Weight = MaxMinSemiring<double>;
+  TestSignal signal;
+  for (int i = 0; i < 10; i++) {
+    signal.push({double(i)}, 1);
+  }
+  ExactComparison<Weight> comparison(std::stringstream(TA), signal, 0.5);
+  BOOST_CHECK(comparison.exactResult.empty());
+  compareWithPreprocessed(comparison, std::stringstream(TA));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include "../src/result_writer.hh"
+
+BOOST_AUTO_TEST_SUITE(ResultWriterTest)
+
+BOOST_AUTO_TEST_CASE( appendFixedTest )
+{
+  // The same as printf including the ties and the values printed by snprintf
+  std::vector<double> values = {0, -0.0, 2.5, -2.5, 0.0000005, 0.0000015, 1e-7, -1e-9, 123456.7890125, 1e12, -1e300,
+                                std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<double> distribution(-1e5, 1e5);
+  for (int i = 0; i < 10000; i++) {
+    values.push_back(distribution(engine));
+    values.push_back(std::round(distribution(engine) * 2) / 2);
+  }
+  for (const double x: values) {
+    std::string buffer;
+    appendFixed(buffer, x);
+    char expected[512];
+    snprintf(expected, sizeof(expected), "%lf", x);
+    BOOST_CHECK_EQUAL(buffer, expected);
+
+    buffer.clear();
+    appendFixedWidth(buffer, x, 10);
+    snprintf(expected, sizeof(expected), "%10lf", x);
+    BOOST_CHECK_EQUAL(buffer, expected);
+  }
+
+  std::string buffer;
+  appendFixed(buffer, 2.5, true);
+  buffer += ' ';
+  appendFixed(buffer, 3.0, true);
+  buffer += ' ';
+  appendFixed(buffer, -0.0, true);
+  BOOST_CHECK_EQUAL(buffer, "2.5 3 0");
+}
+
+//! @brief Write one matching and one degraded interval in the format and return the output
+static std::string writeExample(ResultFormat format, const std::string &tag, OutputThread *background = nullptr) {
+  char *data = nullptr;
+  std::size_t size = 0;
+  FILE *out = open_memstream(&data, &size);
+  {
+    ResultWriter writer(out, format, tag, background);
+    // 1 <= t < 2, 3 < t' <= 4, 1 < t' - t <= 3
+    const std::array<Bounds, 6> arr = {{{-1, true}, {2, false}, {-3, false}, {4, true}, {-1, false}, {3, true}}};
+    writer.writeMatch(arr, -2.5, true);
+    writer.writeMatch(arr, false, false);
+    writer.writeDegraded(5, 6);
+    writer.flush();
+  }
+  fclose(out);
+  std::string result(data, size);
+  free(data);
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE( formatTest )
+{
+  BOOST_CHECK(!parseResultFormat("xml"));
+  BOOST_CHECK(parseResultFormat("jsonl") == boost::optional<ResultFormat>(ResultFormat::jsonl));
+
+  BOOST_CHECK_EQUAL(writeExample(ResultFormat::text, "a"),
+                    "----- Automaton: a -----\n"
+                    "----- Possibly over-approximated -----\n"
+                    "----- Weight: -2.500000 -----\n"
+                    "  1.000000       <= t <   2.000000\n"
+                    "  3.000000        < t' <=   4.000000\n"
+                    "  1.000000        < t' - t <=   3.000000\n"
+                    "=============================\n"
+                    "----- Automaton: a -----\n"
+                    "----- Degraded: 5.000000 <= time < 6.000000 -----\n");
+  BOOST_CHECK_EQUAL(writeExample(ResultFormat::csv, "a"),
+                    "a,-2.5,1,1,1,2,0,3,0,4,1,1,0,3,1\n"
+                    "# degraded,a,5,6\n");
+  BOOST_CHECK_EQUAL(writeExample(ResultFormat::jsonl, ""),
+                    "{\"weight\":-2.5,\"approximate\":true,"
+                    "\"t\":{\"lower\":1,\"lower_closed\":true,\"upper\":2,\"upper_closed\":false},"
+                    "\"tp\":{\"lower\":3,\"lower_closed\":false,\"upper\":4,\"upper_closed\":true},"
+                    "\"duration\":{\"lower\":1,\"lower_closed\":false,\"upper\":3,\"upper_closed\":true}}\n"
+                    "{\"degraded\":{\"begin\":5,\"end\":6}}\n");
+
+  // kind, flags, tag length, weight, and six bounds
+  const std::string binary = writeExample(ResultFormat::binary, "a");
+  BOOST_REQUIRE_EQUAL(binary.size(), (4 + 1 + 8 * 7) + (4 + 1 + 8 * 2));
+  BOOST_CHECK_EQUAL(binary[0], 0);
+  BOOST_CHECK_EQUAL(uint8_t(binary[1]), 1 << 6 | 1 << 0 | 1 << 3 | 1 << 5);
+  double weight;
+  std::memcpy(&weight, binary.data() + 5, sizeof(double));
+  BOOST_CHECK_EQUAL(weight, -2.5);
+  BOOST_CHECK_EQUAL(binary[4 + 1 + 8 * 7], 1);
+
+  // The background thread writes the same output
+  OutputThread background(1);
+  BOOST_CHECK_EQUAL(writeExample(ResultFormat::text, "a", &background), writeExample(ResultFormat::text, "a"));
+}
+
+BOOST_AUTO_TEST_CASE( binaryResultDecoderTest )
+{
+  const std::string binary = ResultWriter::header(ResultFormat::binary) + writeExample(ResultFormat::binary, "a");
+  // Decode the bytes given one by one and write them in the text format
+  char *data = nullptr;
+  std::size_t size = 0;
+  FILE *out = open_memstream(&data, &size);
+  {
+    ResultWriter writer(out, ResultFormat::text, "a");
+    BinaryResultDecoder decoder;
+    BinaryResultDecoder::Record record;
+    std::size_t numOfRecords = 0;
+    for (const char c: binary) {
+      decoder.append(&c, 1);
+      while (decoder.next(record)) {
+        BOOST_CHECK_EQUAL(record.tag, "a");
+        if (record.kind == 0) {
+          writer.writeMatch(record.bounds, record.weight, record.approximate);
+        } else {
+          writer.writeDegraded(record.begin, record.end);
+        }
+        numOfRecords++;
+      }
+    }
+    BOOST_CHECK_EQUAL(numOfRecords, 2);
+  }
+  fclose(out);
+  BOOST_CHECK_EQUAL(std::string(data, size), writeExample(ResultFormat::text, "a"));
+  free(data);
+
+  BinaryResultDecoder decoder;
+  BinaryResultDecoder::Record record;
+  decoder.append("QTPMSIGN", 8);
+  BOOST_CHECK_THROW(decoder.next(record), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
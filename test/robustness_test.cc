@@ -68,7 +68,7 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( SpaceRobustNessTest0, Weight, testTypesInt )
     CM_t(1) < 30
   };
   V_t valuations = {{130, 20}, {150, 10}};
-  Weight result = multipleSpaceRobustness<Weight>(label, valuations);
+  Weight result = multipleSpaceRobustness<Weight, int>(label, valuations);
 
   constexpr int const ans = ans_trait<Weight>::ans;
 
@@ -20,4 +20,13 @@ BOOST_AUTO_TEST_CASE( MaxMinSemiringTest0 )
   BOOST_CHECK_EQUAL((MaxMinSemiring<int>(-2) * MaxMinSemiring<int>::one()).data, -2);
   BOOST_CHECK_EQUAL((MaxMinSemiring<int>(-2).star()).data, MaxMinSemiring<int>::one().data);
 }
+BOOST_AUTO_TEST_CASE( PlusSemiringMultiplyAssignTest )
+{
+  MinPlusSemiring<int> minPlus(-2);
+  minPlus *= MinPlusSemiring<int>(5);
+  BOOST_CHECK_EQUAL(minPlus.data, 3);
+  MaxPlusSemiring<int> maxPlus(-2);
+  maxPlus *= MaxPlusSemiring<int>(5);
+  BOOST_CHECK_EQUAL(maxPlus.data, 3);
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,297 @@
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <thread>
+#include <boost/iostreams/copy.hpp>
+#include "../src/signal_reader.hh"
+
+BOOST_AUTO_TEST_SUITE(SignalReaderTest)
+
+BOOST_AUTO_TEST_CASE( parseDoubleTest )
+{
+  const auto parse = [](const std::string &str, double &value) {
+    return parseDouble(str.data(), str.data() + str.size(), value);
+  };
+  double value;
+  BOOST_REQUIRE(parse("0.1", value));
+  BOOST_CHECK_EQUAL(value, 0.1);
+  BOOST_REQUIRE(parse("-120", value));
+  BOOST_CHECK_EQUAL(value, -120);
+  BOOST_REQUIRE(parse("+2.5e-3", value));
+  BOOST_CHECK_EQUAL(value, 2.5e-3);
+  BOOST_REQUIRE(parse("007.", value));
+  BOOST_CHECK_EQUAL(value, 7);
+  BOOST_REQUIRE(parse("12345678901234567890123", value));
+  BOOST_CHECK_EQUAL(value, 12345678901234567890123.0);
+  BOOST_REQUIRE(parse("1e300", value));
+  BOOST_CHECK_EQUAL(value, 1e300);
+  BOOST_CHECK(!parse("", value));
+  BOOST_CHECK(!parse(".", value));
+  BOOST_CHECK(!parse("1e", value));
+  BOOST_CHECK(!parse("1.2.3", value));
+  BOOST_CHECK(!parse("x", value));
+
+  // The same as strtod
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<double> distribution(-1e6, 1e6);
+  for (int i = 0; i < 10000; i++) {
+    char str[64];
+    snprintf(str, sizeof(str), "%.*f", i % 10, distribution(engine));
+    BOOST_REQUIRE(parse(str, value));
+    BOOST_CHECK_EQUAL(value, std::strtod(str, nullptr));
+  }
+}
+
+//! @brief Read all the lines of the file
+static std::vector<std::vector<double>> readAll(FILE *file, const std::string &format = "text") {
+  const auto readerPtr = makeSignalReader(file, "test", format);
+  SignalReader &reader = *readerPtr;
+  std::vector<std::vector<double>> lines;
+  double time;
+  std::vector<double> valuation;
+  while (reader.next(time, valuation)) {
+    lines.push_back({time});
+    lines.back().insert(lines.back().end(), valuation.begin(), valuation.end());
+  }
+  // The end of the signal is stable
+  BOOST_CHECK(!reader.next(time, valuation));
+  return lines;
+}
+
+BOOST_AUTO_TEST_CASE( readTest )
+{
+  // A line longer than the buffer
+  std::string content = "1 2 3\n\n  2.5\t-4 5\r\n";
+  content += "3";
+  for (int i = 0; i < 20000; i++) {
+    content += " 0.125";
+  }
+  content += "\n4 5";
+
+  const auto check = [&](const std::vector<std::vector<double>> &lines) {
+    BOOST_REQUIRE_EQUAL(lines.size(), 4);
+    BOOST_CHECK((lines[0] == std::vector<double>{1, 2, 3}));
+    BOOST_CHECK((lines[1] == std::vector<double>{2.5, -4, 5}));
+    BOOST_CHECK_EQUAL(lines[2].size(), 20001);
+    BOOST_CHECK_EQUAL(lines[2].back(), 0.125);
+    BOOST_CHECK((lines[3] == std::vector<double>{4, 5}));
+  };
+
+  // A regular file is memory-mapped
+  FILE *file = tmpfile();
+  fwrite(content.data(), 1, content.size(), file);
+  fflush(file);
+  check(readAll(file));
+  fclose(file);
+
+  // A pipe is read by the buffer
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+  FILE *pipeFile = fdopen(fds[0], "r");
+  std::thread writer([&] {
+      BOOST_CHECK_EQUAL(write(fds[1], content.data(), content.size()), ssize_t(content.size()));
+      close(fds[1]);
+    });
+  check(readAll(pipeFile));
+  writer.join();
+  fclose(pipeFile);
+}
+
+BOOST_AUTO_TEST_CASE( malformedTest )
+{
+  const std::string content = "1 2 3\n\n2 3 abc\n";
+  FILE *file = tmpfile();
+  fwrite(content.data(), 1, content.size(), file);
+  fflush(file);
+  TextSignalReader reader(file, "signal.txt");
+  double time;
+  std::vector<double> valuation;
+  BOOST_CHECK(reader.next(time, valuation));
+  try {
+    reader.next(time, valuation);
+    BOOST_FAIL("The malformed line is not reported");
+  } catch (const std::runtime_error &e) {
+    BOOST_CHECK_EQUAL(std::string(e.what()), "signal.txt:3: malformed number \"abc\"");
+  }
+  fclose(file);
+}
+
+//! @brief Append the binary representation of the value
+template<class T>
+static void append(std::string &content, T value) {
+  content.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static std::string binaryHeader(uint32_t numOfVariables, bool isAbsTime, BinarySignalReader::ValueType valueType, BinarySignalReader::Layout layout) {
+  std::string content = "QTPMSIGN";
+  append(content, uint32_t(1));
+  append(content, numOfVariables);
+  append(content, uint8_t(isAbsTime));
+  append(content, valueType);
+  append(content, layout);
+  append(content, uint8_t(0));
+  return content;
+}
+
+//! @brief Make a temporary file with the content
+static FILE *temporaryFile(const std::string &content) {
+  FILE *file = tmpfile();
+  fwrite(content.data(), 1, content.size(), file);
+  fflush(file);
+  return file;
+}
+
+BOOST_AUTO_TEST_CASE( binaryRecordsTest )
+{
+  std::string content = binaryHeader(2, true, BinarySignalReader::ValueType::float32, BinarySignalReader::Layout::records);
+  for (float v: {1.0f, 2.5f, -3.0f, 2.0f, 0.25f, 4.0f}) {
+    append(content, v);
+  }
+  FILE *file = temporaryFile(content);
+  {
+    BinarySignalReader reader(file, "test");
+    BOOST_CHECK(reader.isAbsTime() == boost::optional<bool>(true));
+  }
+  const auto lines = readAll(file, "binary");
+  BOOST_REQUIRE_EQUAL(lines.size(), 2);
+  BOOST_CHECK((lines[0] == std::vector<double>{1, 2.5, -3}));
+  BOOST_CHECK((lines[1] == std::vector<double>{2, 0.25, 4}));
+  fclose(file);
+
+  // A truncated piece is reported
+  file = temporaryFile(content.substr(0, content.size() - 2));
+  BinarySignalReader reader(file, "test");
+  double time;
+  std::vector<double> valuation;
+  BOOST_CHECK(reader.next(time, valuation));
+  BOOST_CHECK_THROW(reader.next(time, valuation), std::runtime_error);
+  fclose(file);
+
+  // An invalid header is reported
+  file = temporaryFile("1 2 3\n4 5 6\n7 8 9\n");
+  BOOST_CHECK_THROW(BinarySignalReader(file, "test"), std::runtime_error);
+  fclose(file);
+
+  // An absurd width is rejected before reading any piece
+  for (uint32_t width: {BinarySignalReader::maxNumOfVariables + 1, std::numeric_limits<uint32_t>::max()}) {
+    file = temporaryFile(binaryHeader(width, true, BinarySignalReader::ValueType::float64, BinarySignalReader::Layout::records));
+    BOOST_CHECK_THROW(BinarySignalReader(file, "test"), std::runtime_error);
+    fclose(file);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( binaryColumnBlocksTest )
+{
+  std::string content = binaryHeader(2, false, BinarySignalReader::ValueType::float64, BinarySignalReader::Layout::columnBlocks);
+  // A block of two pieces, an empty block, and a block of one piece
+  append(content, uint32_t(2));
+  for (double v: {1.0, 2.0, 10.0, 20.0, 100.0, 200.0}) {
+    append(content, v);
+  }
+  append(content, uint32_t(0));
+  append(content, uint32_t(1));
+  for (double v: {3.0, 30.0, 300.0}) {
+    append(content, v);
+  }
+  const auto check = [](const std::vector<std::vector<double>> &lines) {
+    BOOST_REQUIRE_EQUAL(lines.size(), 3);
+    BOOST_CHECK((lines[0] == std::vector<double>{1, 10, 100}));
+    BOOST_CHECK((lines[1] == std::vector<double>{2, 20, 200}));
+    BOOST_CHECK((lines[2] == std::vector<double>{3, 30, 300}));
+  };
+
+  FILE *file = temporaryFile(content);
+  check(readAll(file, "binary"));
+  fclose(file);
+
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+  FILE *pipeFile = fdopen(fds[0], "r");
+  std::thread writer([&] {
+      BOOST_CHECK_EQUAL(write(fds[1], content.data(), content.size()), ssize_t(content.size()));
+      close(fds[1]);
+    });
+  check(readAll(pipeFile, "binary"));
+  writer.join();
+  fclose(pipeFile);
+
+  // The largest block of the widest signal is reported as truncated without allocating the memory for it
+  content = binaryHeader(BinarySignalReader::maxNumOfVariables, false, BinarySignalReader::ValueType::float64, BinarySignalReader::Layout::columnBlocks);
+  append(content, std::numeric_limits<uint32_t>::max());
+  append(content, 1.0);
+  file = temporaryFile(content);
+  BinarySignalReader reader(file, "test");
+  double time;
+  std::vector<double> valuation;
+  BOOST_CHECK_THROW(reader.next(time, valuation), std::runtime_error);
+  fclose(file);
+}
+
+//! @brief Compress the content by the given compressor
+template<class Compressor>
+static std::string compress(const std::string &content) {
+  std::string compressed;
+  boost::iostreams::filtering_ostream stream;
+  stream.push(Compressor());
+  stream.push(boost::iostreams::back_inserter(compressed));
+  stream.write(content.data(), content.size());
+  stream.reset();
+  return compressed;
+}
+
+BOOST_AUTO_TEST_CASE( compressedTest )
+{
+  std::string content;
+  for (int i = 0; i < 10000; i++) {
+    content += std::to_string(i) + " " + std::to_string(i * 0.5) + "\n";
+  }
+  const auto check = [&](const std::vector<std::vector<double>> &lines) {
+    BOOST_REQUIRE_EQUAL(lines.size(), 10000);
+    BOOST_CHECK((lines[0] == std::vector<double>{0, 0}));
+    BOOST_CHECK((lines[9999] == std::vector<double>{9999, 4999.5}));
+  };
+
+  FILE *file = temporaryFile(compress<boost::iostreams::gzip_compressor>(content));
+  BOOST_CHECK_EQUAL(detectCompression(file), "gzip");
+  check(readAll(file));
+  fclose(file);
+
+  file = temporaryFile(compress<boost::iostreams::bzip2_compressor>(content));
+  BOOST_CHECK_EQUAL(detectCompression(file), "bzip2");
+  check(readAll(file));
+  fclose(file);
+
+#ifdef QTPM_HAVE_ZSTD
+  file = temporaryFile(compress<boost::iostreams::zstd_compressor>(content));
+  BOOST_CHECK_EQUAL(detectCompression(file), "zstd");
+  check(readAll(file));
+  fclose(file);
+#endif
+
+  // The binary signal can also be compressed
+  std::string binary = binaryHeader(1, false, BinarySignalReader::ValueType::float64, BinarySignalReader::Layout::records);
+  for (int i = 0; i < 10000; i++) {
+    append(binary, double(i));
+    append(binary, i * 0.5);
+  }
+  file = temporaryFile(compress<boost::iostreams::gzip_compressor>(binary));
+  check(readAll(file, "binary"));
+  fclose(file);
+}
+
+BOOST_AUTO_TEST_CASE( corruptedCompressedTest )
+{
+  std::string compressed = compress<boost::iostreams::gzip_compressor>("1 2\n2 3\n");
+  // Break the deflate stream
+  compressed.resize(compressed.size() - 12);
+  for (std::size_t i = 10; i < compressed.size(); i++) {
+    compressed[i] = ~compressed[i];
+  }
+  FILE *file = temporaryFile(compressed);
+  const auto reader = makeSignalReader(file, "signal.txt.gz", "text");
+  double time;
+  std::vector<double> valuation;
+  BOOST_CHECK_THROW(while (reader->next(time, valuation)) {}, std::runtime_error);
+  fclose(file);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,95 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../src/timed_automaton_analysis.hh"
+
+BOOST_AUTO_TEST_SUITE(timedAutomatonAnalysisTests)
+
+using SignalVariables = uint8_t;
+using ClockVariables = uint8_t;
+
+static boost::optional<double> maxMatchDurationOf(const std::string &fileName) {
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file(fileName);
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  parseBoostTA(file, TA, initStates);
+  return maxMatchDuration(TA, initStates);
+}
+
+BOOST_AUTO_TEST_CASE(maxMatchDurationTest)
+{
+  // x1 is never reset and bounds the transition to the accepting state
+  const auto ringing = maxMatchDurationOf("../experiments/ringing.dot");
+  BOOST_REQUIRE(ringing);
+  BOOST_CHECK_EQUAL(*ringing, 80);
+
+  const auto overshoot = maxMatchDurationOf("../experiments/overshoot.dot");
+  BOOST_REQUIRE(overshoot);
+  BOOST_CHECK_EQUAL(*overshoot, 150);
+
+  // The only clock variable bounding the duration is reset
+  BOOST_CHECK(!maxMatchDurationOf("../example/paper.dot"));
+  // The transition to the accepting state has no guard
+  BOOST_CHECK(!maxMatchDurationOf("../experiments/overshoot_unbounded.dot"));
+}
+
+BOOST_AUTO_TEST_CASE(maxFeasibleDurationsTest)
+{
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../experiments/ringing.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  parseBoostTA(file, TA, initStates);
+  const auto maxDurations = maxFeasibleDurations(TA);
+  BOOST_REQUIRE_EQUAL(maxDurations.size(), boost::num_vertices(TA));
+  for (auto range = boost::vertices(TA); range.first != range.second; range.first++) {
+    if (TA[*range.first].isMatch) {
+      // No accepting state is reachable from the accepting state
+      BOOST_CHECK_EQUAL(maxDurations[*range.first], -std::numeric_limits<double>::infinity());
+    } else {
+      BOOST_CHECK_EQUAL(maxDurations[*range.first], 80);
+    }
+  }
+
+  // The only clock variable bounding the duration is reset
+  BoostTimedAutomaton<SignalVariables, ClockVariables> paperTA;
+  std::ifstream paperFile("../example/paper.dot");
+  parseBoostTA(paperFile, paperTA, initStates);
+  const auto paperMaxDurations = maxFeasibleDurations(paperTA);
+  BOOST_CHECK_EQUAL(paperMaxDurations[0], std::numeric_limits<double>::infinity());
+  BOOST_CHECK_EQUAL(paperMaxDurations[1], std::numeric_limits<double>::infinity());
+  BOOST_CHECK_EQUAL(paperMaxDurations[2], -std::numeric_limits<double>::infinity());
+
+  // The bound of the initial state is tighter than the one of the whole matching
+  BoostTimedAutomaton<SignalVariables, ClockVariables> overshootTA;
+  std::ifstream overshootFile("../experiments/overshoot.dot");
+  parseBoostTA(overshootFile, overshootTA, initStates);
+  const auto overshootMaxDurations = maxFeasibleDurations(overshootTA);
+  BOOST_CHECK_EQUAL(overshootMaxDurations[0], 10);
+  BOOST_CHECK_EQUAL(overshootMaxDurations[1], 150);
+}
+
+BOOST_AUTO_TEST_CASE(activeClockVariablesTest)
+{
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::ifstream file("../test/small3.dot");
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStates;
+  parseBoostTA(file, TA, initStates);
+  const auto isActive = activeClockVariables(TA);
+  BOOST_REQUIRE_EQUAL(isActive.size(), 3);
+  // x0 is reset when leaving 0 and read when leaving 1 and 2
+  BOOST_CHECK(!isActive[0][0]);
+  BOOST_CHECK(isActive[1][0]);
+  BOOST_CHECK(isActive[2][0]);
+
+  BoostTimedAutomaton<SignalVariables, ClockVariables> ringingTA;
+  std::ifstream ringingFile("../experiments/ringing.dot");
+  parseBoostTA(ringingFile, ringingTA, initStates);
+  const auto isActiveRinging = activeClockVariables(ringingTA);
+  for (auto range = boost::vertices(ringingTA); range.first != range.second; range.first++) {
+    // No clock variable is read after the accepting state
+    const bool expected = !ringingTA[*range.first].isMatch;
+    BOOST_CHECK_EQUAL(isActiveRinging[*range.first][0], expected);
+    BOOST_CHECK_EQUAL(isActiveRinging[*range.first][1], expected);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,88 @@
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+#include "../src/timed_automaton_preprocessing.hh"
+
+BOOST_AUTO_TEST_SUITE(timedAutomatonPreprocessingTests)
+
+using SignalVariables = uint8_t;
+using ClockVariables = uint8_t;
+using TA_t = BoostTimedAutomaton<SignalVariables, ClockVariables>;
+
+static PreprocessingReport preprocess(const std::string &fileName, TA_t &TA, std::vector<TA_t::vertex_descriptor> &initStates) {
+  std::ifstream file(fileName);
+  parseBoostTA(file, TA, initStates);
+  return preprocessBoostTA(TA, initStates);
+}
+
+BOOST_AUTO_TEST_CASE(redundantTest)
+{
+  TA_t TA;
+  std::vector<TA_t::vertex_descriptor> initStates;
+  const auto report = preprocess("../test/redundant.dot", TA, initStates);
+
+  BOOST_CHECK_EQUAL(report.numOfStatesBefore, 7);
+  // 9 is unreachable, 8 cannot reach the accepting state, and 1 and 4 are bisimilar
+  BOOST_CHECK_EQUAL(report.numOfUnreachableStates, 1);
+  BOOST_CHECK_EQUAL(report.numOfUselessStates, 1);
+  BOOST_CHECK_EQUAL(report.numOfMergedStates, 1);
+  BOOST_CHECK_EQUAL(report.numOfStatesAfter, 4);
+  BOOST_CHECK_EQUAL(boost::num_vertices(TA), 4);
+
+  BOOST_CHECK_EQUAL(report.numOfTransitionsBefore, 8);
+  BOOST_CHECK_EQUAL(report.numOfUnsatisfiableTransitions, 1);
+  BOOST_CHECK_EQUAL(report.numOfTransitionsAfter, 3);
+  BOOST_CHECK_EQUAL(boost::num_edges(TA), 3);
+
+  // x2 is renamed to x0, and x1 shares x0 because x0 is dead when x1 is reset
+  BOOST_CHECK_EQUAL(report.numOfClockVariablesBefore, 4);
+  BOOST_CHECK_EQUAL(report.numOfClockVariablesAfter, 2);
+  BOOST_CHECK_EQUAL(boost::get_property(TA, boost::graph_num_of_vars), 2);
+  for (auto range = boost::edges(TA); range.first != range.second; range.first++) {
+    for (const auto &delta: TA[*range.first].guard) {
+      BOOST_CHECK_LT(delta.x, 2);
+    }
+    for (const auto x: TA[*range.first].resetVars.resetVars) {
+      BOOST_CHECK_LT(x, 2);
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(initStates.size(), 1);
+  BOOST_CHECK(!TA[initStates.front()].isMatch);
+  BOOST_CHECK_EQUAL(boost::out_degree(initStates.front(), TA), 1);
+}
+
+BOOST_AUTO_TEST_CASE(minimalTest)
+{
+  // Nothing is removed from an automaton without redundancy
+  TA_t TA;
+  std::vector<TA_t::vertex_descriptor> initStates;
+  const auto report = preprocess("../example/paper.dot", TA, initStates);
+  BOOST_CHECK_EQUAL(report.numOfStatesBefore, report.numOfStatesAfter);
+  BOOST_CHECK_EQUAL(report.numOfTransitionsBefore, report.numOfTransitionsAfter);
+  BOOST_CHECK_EQUAL(report.numOfClockVariablesBefore, report.numOfClockVariablesAfter);
+  BOOST_CHECK_EQUAL(boost::num_vertices(TA), 3);
+  BOOST_CHECK_EQUAL(boost::num_edges(TA), 2);
+}
+
+BOOST_AUTO_TEST_CASE(neverResetClockTest)
+{
+  // x0 and x2 are never reset before the guard and they are always equal. The resets to the accepting state are dead.
+  TA_t TA;
+  std::vector<TA_t::vertex_descriptor> initStates;
+  const auto report = preprocess("../test/timed_automaton.dot", TA, initStates);
+  BOOST_CHECK_EQUAL(report.numOfClockVariablesBefore, 3);
+  BOOST_CHECK_EQUAL(report.numOfClockVariablesAfter, 1);
+}
+
+BOOST_AUTO_TEST_CASE(emptyLanguageTest)
+{
+  // No accepting state is reachable
+  TA_t TA;
+  std::vector<TA_t::vertex_descriptor> initStates;
+  const auto report = preprocess("../test/small4.dot", TA, initStates);
+  BOOST_CHECK_EQUAL(report.numOfStatesAfter, 0);
+  BOOST_CHECK(initStates.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
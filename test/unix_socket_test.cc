@@ -0,0 +1,60 @@
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include "../src/unix_socket.hh"
+
+BOOST_AUTO_TEST_SUITE(UnixSocketTest)
+
+BOOST_AUTO_TEST_CASE( connectTest )
+{
+  char directory[] = "/tmp/qtpm-socket-XXXXXX";
+  BOOST_REQUIRE(mkdtemp(directory));
+  const std::string path = std::string(directory) + "/daemon.sock";
+  // A socket left by a killed daemon is replaced
+  close(listenUnixSocket(path));
+  const int listener = listenUnixSocket(path);
+
+  const std::string message(1 << 20, 'q');
+  std::thread client([&] {
+      const int fd = connectUnixSocket(path);
+      // The large message is written while the peer reads it
+      BOOST_CHECK(writeAll(fd, message.data(), message.size()));
+      close(fd);
+    });
+  const int fd = accept(listener, nullptr, nullptr);
+  BOOST_REQUIRE_GE(fd, 0);
+  std::string received;
+  char buffer[4096];
+  ssize_t size;
+  while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+    received.append(buffer, size);
+  }
+  client.join();
+  BOOST_CHECK(received == message);
+  close(fd);
+  close(listener);
+
+  // A socket someone listens on is kept
+  const int other = listenUnixSocket(path);
+  BOOST_CHECK_THROW(listenUnixSocket(path), std::runtime_error);
+  close(connectUnixSocket(path));
+  close(other);
+
+  // A missing socket and a too long path
+  BOOST_CHECK_THROW(connectUnixSocket(path + ".missing"), std::runtime_error);
+  BOOST_CHECK_THROW(listenUnixSocket(std::string(200, 'x')), std::runtime_error);
+  unlink(path.c_str());
+  rmdir(directory);
+}
+
+BOOST_AUTO_TEST_CASE( closedPeerTest )
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  close(fds[1]);
+  // The write to the closed peer fails without SIGPIPE terminating the test
+  const std::string message = "piece";
+  BOOST_CHECK(!writeAll(fds[0], message.data(), message.size()));
+  close(fds[0]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
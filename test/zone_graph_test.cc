@@ -77,14 +77,16 @@ BOOST_AUTO_TEST_CASE(zoneConstructionWithTTest0)
   const auto max_constraints = boost::get_property(TA, boost::graph_max_constraints);
   zeroDBM.M = Bounds{max_constraints, true};
   for (const auto &init: initStatesTA) {
-    initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{init, false, zeroDBM, std::vector<std::vector<Value>>{}}, Weight::one());
+    initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{init, false, zeroDBM, PieceRange{}}, Weight::one());
   }
+  PieceStore<Value> pieces;
+  pieces.push({20, 30});
 
   BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value> ZG;
   std::unordered_map<typename BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>::vertex_descriptor, Weight> initStatesZG;
 
-  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables>;
-  zoneConstructionWithT(TA, initConfTA, cost, std::vector<Value>{20, 30}, 3.0, ZG, initStatesZG);
+  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
+  zoneConstructionWithT(TA, initConfTA, cost, pieces, 3.0, ZG, initStatesZG);
 
   // TODO: write some tests
 }
@@ -125,20 +127,25 @@ BOOST_AUTO_TEST_CASE(zoneConstructionWithTTest1)
   BOOST_CHECK_EQUAL(target((*boost::out_edges(q2, TA).first), TA), q0);
 
   initConfTA.reserve(2);
-  initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q0, false, zeroDBM, std::vector<std::vector<Value>>{}}, Weight::one());
+  initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q0, false, zeroDBM, PieceRange{}}, Weight::one());
   zeroDBM.elapse();
-  const std::vector<std::vector<Value>> valuations = {{130, 20}, {150, 10}};
-  initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q1, true,  zeroDBM, valuations}, Weight::one());
+  // q1 has been observing the pieces since the first one
+  PieceStore<Value> pieces;
+  for (const std::vector<Value> &valuation: {std::vector<Value>{130, 20}, std::vector<Value>{150, 10}, std::vector<Value>{20, 30}}) {
+    pieces.push(valuation);
+  }
+  initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q1, true,  zeroDBM, PieceRange{0, 3}}, Weight::one());
 
   BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value> ZG;
   std::unordered_map<typename BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>::vertex_descriptor, Weight> initStatesZG;
 
-  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables>;
-  zoneConstructionWithT(TA, initConfTA, cost, std::vector<Value>{20, 30}, 3.0, ZG, initStatesZG);
+  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
+  zoneConstructionWithT(TA, initConfTA, cost, pieces, 3.0, ZG, initStatesZG);
 
   // TODO: write some tests
   BOOST_CHECK_EQUAL(initStatesZG.size(), 2);
-  BOOST_CHECK_EQUAL(boost::num_vertices(ZG), 7 + 6);
+  // zeroDBM is canonical after the release, and the same zones are merged
+  BOOST_CHECK_EQUAL(boost::num_vertices(ZG), 7);
 
   // const std::array<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor, 2> expectedInitZGTAStates = {{q0, q1}};
   // const std::array<bool, 2> expectedInitZGBs = {{false, true}};
@@ -147,7 +154,7 @@ BOOST_AUTO_TEST_CASE(zoneConstructionWithTTest1)
   // for (int i = 0; i < 2; i++) {
   //   BOOST_CHECK_EQUAL(ZG[initStatesZG[i].first].vertex, expectedInitZGTAStates[i]);
   //   BOOST_CHECK_EQUAL(ZG[initStatesZG[i].first].jumpable, expectedInitZGBs[i]);
-  //   BOOST_CHECK_EQUAL(ZG[initStatesZG[i].first].valuations.size(), expectedInitZGValuationsSize[i]);
+  //   BOOST_CHECK_EQUAL(ZG[initStatesZG[i].first].history.size(), expectedInitZGValuationsSize[i]);
   // }
 
 }
@@ -187,20 +194,25 @@ BOOST_AUTO_TEST_CASE(zoneConstructionWithTForPatternMatchingTest1)
   BOOST_CHECK_EQUAL(target((*boost::out_edges(q2, TA).first), TA), q0);
 
   initConfTA.reserve(2);
-  initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q0, false, zeroDBM, std::vector<std::vector<Value>>{}}, Weight::one());
+  initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q0, false, zeroDBM, PieceRange{}}, Weight::one());
   zeroDBM.elapse();
-  const std::vector<std::vector<Value>> valuations = {{130, 20}, {150, 10}};
-  initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q1, true,  zeroDBM, valuations}, Weight::one());
+  // q1 has been observing the pieces since the first one
+  PieceStore<Value> pieces;
+  for (const std::vector<Value> &valuation: {std::vector<Value>{130, 20}, std::vector<Value>{150, 10}, std::vector<Value>{20, 30}}) {
+    pieces.push(valuation);
+  }
+  initConfTA.emplace_back(BoostZoneGraphState<SignalVariables, ClockVariables, Value>{q1, true,  zeroDBM, PieceRange{0, 3}}, Weight::one());
 
   BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value> ZG;
   std::unordered_map<typename BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>::vertex_descriptor, Weight> initStatesZG;
 
-  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const std::vector<std::vector<Value>> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables>;
-  zoneConstructionWithT(TA, initConfTA, cost, std::vector<Value>{20, 30}, 3.0, ZG, initStatesZG);
+  std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
+  zoneConstructionWithT(TA, initConfTA, cost, pieces, 3.0, ZG, initStatesZG);
 
   // TODO: write some tests
   BOOST_CHECK_EQUAL(initStatesZG.size(), 2);
-  BOOST_CHECK_EQUAL(boost::num_vertices(ZG), 7 + 6);
+  // zeroDBM is canonical after the release, and the same zones are merged
+  BOOST_CHECK_EQUAL(boost::num_vertices(ZG), 7);
 
   // const std::array<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor, 2> expectedInitZGTAStates = {{q0, q1}};
   // const std::array<bool, 2> expectedInitZGBs = {{false, true}};
@@ -209,9 +221,109 @@ BOOST_AUTO_TEST_CASE(zoneConstructionWithTForPatternMatchingTest1)
   // for (int i = 0; i < 2; i++) {
   //   BOOST_CHECK_EQUAL(ZG[initStatesZG[i].first].vertex, expectedInitZGTAStates[i]);
   //   BOOST_CHECK_EQUAL(ZG[initStatesZG[i].first].jumpable, expectedInitZGBs[i]);
-  //   BOOST_CHECK_EQUAL(ZG[initStatesZG[i].first].valuations.size(), expectedInitZGValuationsSize[i]);
+  //   BOOST_CHECK_EQUAL(ZG[initStatesZG[i].first].history.size(), expectedInitZGValuationsSize[i]);
   // }
 
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(zoneConstructionCornerCaseTest)
+
+using SignalVariables = uint8_t;
+using ClockVariables = uint8_t;
+using Weight = MaxMinSemiring<double>;
+using Value = double;
+using ZGState_t = BoostZoneGraphState<SignalVariables, ClockVariables, Value>;
+
+/*
+  The TA in test/small5.dot goes 0 -> 2 -> 3 (accepting) without guards, 4 -> 3 only when x0 > 5, and 1 has no transition.
+  We construct the zone graph of a piece of duration 3, so the transition from 4 is possible only in a later piece.
+ */
+struct CornerCaseFixture {
+  BoostTimedAutomaton<SignalVariables, ClockVariables> TA;
+  std::vector<typename BoostTimedAutomaton<SignalVariables, ClockVariables>::vertex_descriptor> initStatesTA;
+  BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value> ZG;
+  std::unordered_map<typename BoostZoneGraph<SignalVariables, ClockVariables, Weight, Value>::vertex_descriptor, Weight> initStatesZG;
+  PieceStore<Value> pieces;
+  //! @brief The zone at the beginning of the piece, where x0 and the dwell time are 0
+  DBM zeroDBM;
+
+  CornerCaseFixture() {
+    std::ifstream file("../test/small5.dot");
+    parseBoostTA(file, TA, initStatesTA);
+    zeroDBM = DBM::zero(boost::get_property(TA, boost::graph_num_of_vars) + 2);
+    zeroDBM.M = Bounds{boost::get_property(TA, boost::graph_max_constraints), true};
+    pieces.push({0});
+  }
+
+  void construct(const std::vector<std::pair<ZGState_t, Weight>> &initConfTA) {
+    std::function<Weight(const std::vector<Constraint<ClockVariables>> &,const PieceHistory<Value> &)> cost = multipleSpaceRobustness<Weight, Value, ClockVariables, PieceHistory<Value>>;
+    zoneConstructionWithT(TA, initConfTA, cost, pieces, 3.0, ZG, initStatesZG);
+  }
+
+  bool hasState(std::size_t q, bool jumpable) const {
+    for (auto range = boost::vertices(ZG); range.first != range.second; range.first++) {
+      if (ZG[*range.first].vertex == q && ZG[*range.first].jumpable == jumpable) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+BOOST_FIXTURE_TEST_CASE(reusedDescriptorTest, CornerCaseFixture)
+{
+  DBM elapsed = zeroDBM;
+  elapsed.elapse();
+  // The nodes at 1 are removed first, and the nodes at 2 added next in the same iteration may get their descriptors
+  std::vector<std::pair<ZGState_t, Weight>> initConfTA;
+  for (const bool jumpable: {false, true}) {
+    for (int i = 1; i <= 12; i++) {
+      DBM zone = elapsed;
+      zone.tighten(0, -1, {i / 4.0, true});
+      initConfTA.emplace_back(ZGState_t{jumpable ? 0u : 1u, jumpable, zone, jumpable ? PieceRange{0, 1} : PieceRange{}}, Weight::one());
+    }
+  }
+  construct(initConfTA);
+  BOOST_CHECK(!hasState(1, false));
+  // Every node at 2 is still expanded
+  std::size_t numOfNodes = 0;
+  for (auto range = boost::vertices(ZG); range.first != range.second; range.first++) {
+    if (ZG[*range.first].vertex == 2 && !ZG[*range.first].jumpable) {
+      numOfNodes++;
+      BOOST_CHECK_GT(boost::out_degree(*range.first, ZG), 0);
+    }
+  }
+  BOOST_CHECK_EQUAL(numOfNodes, 12);
+}
+
+BOOST_FIXTURE_TEST_CASE(leaveInLaterPieceTest, CornerCaseFixture)
+{
+  // The run entering 4 in this piece can leave it only in a later piece
+  construct({{ZGState_t{4, false, zeroDBM, PieceRange{}}, Weight::one()}});
+  BOOST_CHECK(hasState(4, false));
+  BOOST_CHECK(hasState(4, true));
+  BOOST_CHECK(!hasState(3, false));
+}
+
+BOOST_FIXTURE_TEST_CASE(futureTransitionTest, CornerCaseFixture)
+{
+  DBM elapsed = zeroDBM;
+  elapsed.elapse();
+  // The run at 4 since the previous piece has no transition now, but it has one after more time elapses
+  construct({{ZGState_t{4, true, elapsed, PieceRange{0, 1}}, Weight::one()}});
+  BOOST_CHECK_EQUAL(initStatesZG.size(), 1);
+  BOOST_CHECK(hasState(4, true));
+}
+
+BOOST_FIXTURE_TEST_CASE(sameKeyTest, CornerCaseFixture)
+{
+  // The two nodes have the same key and both of them are useless
+  construct({{ZGState_t{1, false, zeroDBM, PieceRange{}}, Weight::one()},
+             {ZGState_t{1, false, zeroDBM, PieceRange{}}, Weight(0.5)}});
+  BOOST_CHECK(initStatesZG.empty());
+  BOOST_CHECK_EQUAL(boost::num_vertices(ZG), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()